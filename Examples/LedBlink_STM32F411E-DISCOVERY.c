@@ -14,7 +14,7 @@ task1_blueLED ()
 {
   while (1)
     {
-      GPIOD_ODR ^= (1 << 15);
+      GPIO_TOGGLE (D, 15);
       taskDelay (1000);
     }
 }
@@ -24,7 +24,7 @@ task2_greenLED ()
 {
   while (1)
     {
-      GPIOD_ODR ^= (1 << 12);
+      GPIO_TOGGLE (D, 12);
       taskDelay (500);
     }
 }
@@ -0,0 +1,303 @@
+/**
+ * @file    atomic.h
+ * @brief   Lock-free atomic primitives for SRTOS.
+ * @details
+ * Header-only atomic operations built on the Cortex-M4 exclusive access
+ * instructions (LDREX/STREX). They never mask interrupts, so they can be used
+ * on data shared between tasks and interrupts of any priority without a
+ * critical section. An exclusive store fails if an exception occured since
+ * the matching exclusive load, so every read-modify-write simply retries.
+ *
+ * When built for a host (any target without LDREX/STREX), the same API is
+ * implemented with the GCC `__atomic` builtins so code using it can be tested
+ * off-target.
+ */
+
+#ifndef ATOMIC_H_
+#define ATOMIC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief This struct is a node of a lock-free stack. Embed it in the structure that is pushed.
+ */
+typedef struct AtomicStackNode AtomicStackNode;
+
+struct AtomicStackNode
+{
+  AtomicStackNode *next;
+};
+
+/**
+ * @brief This struct is a lock-free LIFO stack of AtomicStackNodes.
+ */
+typedef struct
+{
+  AtomicStackNode *volatile head;
+} AtomicStack;
+
+#if defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_7M__)
+
+/**
+ * @brief Load a word and mark its address for an exclusive store.
+ * 
+ * @warning This function should not be called by user code.
+ */
+static inline uint32_t
+atomicLoadExclusive (volatile uint32_t *addr)
+{
+  uint32_t value;
+  __asm volatile ("LDREX %[value], [%[addr]]\n"
+                  : [value] "=r"(value)
+                  : [addr] "r"(addr)
+                  : "memory");
+  return value;
+}
+
+/**
+ * @brief Store a word if no exception or other exclusive store happened since atomicLoadExclusive ().
+ * 
+ * @return Returns 0 if the store succeeded, and 1 if it failed and must be retried.
+ * 
+ * @warning This function should not be called by user code.
+ */
+static inline uint32_t
+atomicStoreExclusive (volatile uint32_t *addr, uint32_t value)
+{
+  uint32_t failed;
+  __asm volatile ("STREX %[failed], %[value], [%[addr]]\n"
+                  : [failed] "=&r"(failed)
+                  : [addr] "r"(addr), [value] "r"(value)
+                  : "memory");
+  return failed;
+}
+
+/**
+ * @brief Clear the exclusive monitor after an atomicLoadExclusive () that is not followed by a store.
+ * 
+ * @warning This function should not be called by user code.
+ */
+static inline void
+atomicClearExclusive ()
+{
+  __asm volatile ("CLREX\n" ::: "memory");
+}
+
+/**
+ * @brief Atomically replace *addr with desired if it equals expected.
+ * 
+ * @return Returns 1 if *addr was replaced, and 0 otherwise.
+ */
+static inline uint32_t
+atomicCompareAndSwap (volatile uint32_t *addr, uint32_t expected,
+                      uint32_t desired)
+{
+  do
+    {
+      if (atomicLoadExclusive (addr) != expected)
+        {
+          atomicClearExclusive ();
+          return 0;
+        }
+    }
+  while (atomicStoreExclusive (addr, desired));
+
+  return 1;
+}
+
+/**
+ * @brief Atomically add value to *addr.
+ * 
+ * @return Returns the value of *addr before the addition.
+ */
+static inline uint32_t
+atomicFetchAdd (volatile uint32_t *addr, uint32_t value)
+{
+  uint32_t oldValue;
+  do
+    {
+      oldValue = atomicLoadExclusive (addr);
+    }
+  while (atomicStoreExclusive (addr, oldValue + value));
+
+  return oldValue;
+}
+
+/**
+ * @brief Atomically replace *addr with value.
+ * 
+ * @return Returns the value of *addr before it was replaced.
+ */
+static inline uint32_t
+atomicExchange (volatile uint32_t *addr, uint32_t value)
+{
+  uint32_t oldValue;
+  do
+    {
+      oldValue = atomicLoadExclusive (addr);
+    }
+  while (atomicStoreExclusive (addr, value));
+
+  return oldValue;
+}
+
+/**
+ * @brief Atomically set the bits of mask in *addr.
+ * 
+ * @return Returns the value of *addr before the bits were set.
+ */
+static inline uint32_t
+atomicSetBits (volatile uint32_t *addr, uint32_t mask)
+{
+  uint32_t oldValue;
+  do
+    {
+      oldValue = atomicLoadExclusive (addr);
+    }
+  while (atomicStoreExclusive (addr, oldValue | mask));
+
+  return oldValue;
+}
+
+/**
+ * @brief Atomically clear the bits of mask in *addr.
+ * 
+ * @return Returns the value of *addr before the bits were cleared.
+ */
+static inline uint32_t
+atomicClearBits (volatile uint32_t *addr, uint32_t mask)
+{
+  uint32_t oldValue;
+  do
+    {
+      oldValue = atomicLoadExclusive (addr);
+    }
+  while (atomicStoreExclusive (addr, oldValue & ~mask));
+
+  return oldValue;
+}
+
+/**
+ * @brief Push a node onto a lock-free stack.
+ */
+static inline void
+atomicStackPush (AtomicStack *stack, AtomicStackNode *node)
+{
+  volatile uint32_t *head = (volatile uint32_t *)&stack->head;
+  do
+    {
+      node->next = (AtomicStackNode *)atomicLoadExclusive (head);
+    }
+  while (atomicStoreExclusive (head, (uint32_t)node));
+}
+
+/**
+ * @brief Pop the most recently pushed node from a lock-free stack.
+ * 
+ * @return Returns the popped node, or NULL if the stack is empty.
+ * 
+ * @note The exclusive store fails if anything touched the stack since the head was loaded, so pop is not affected by the ABA problem.
+ */
+static inline AtomicStackNode *
+atomicStackPop (AtomicStack *stack)
+{
+  volatile uint32_t *head = (volatile uint32_t *)&stack->head;
+  AtomicStackNode *node;
+  do
+    {
+      node = (AtomicStackNode *)atomicLoadExclusive (head);
+      if (node == NULL)
+        {
+          atomicClearExclusive ();
+          return NULL;
+        }
+    }
+  while (atomicStoreExclusive (head, (uint32_t)node->next));
+
+  return node;
+}
+
+#else
+
+static inline uint32_t
+atomicCompareAndSwap (volatile uint32_t *addr, uint32_t expected,
+                      uint32_t desired)
+{
+  return __atomic_compare_exchange_n (addr, &expected, desired, 0,
+                                      __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline uint32_t
+atomicFetchAdd (volatile uint32_t *addr, uint32_t value)
+{
+  return __atomic_fetch_add (addr, value, __ATOMIC_SEQ_CST);
+}
+
+static inline uint32_t
+atomicExchange (volatile uint32_t *addr, uint32_t value)
+{
+  return __atomic_exchange_n (addr, value, __ATOMIC_SEQ_CST);
+}
+
+static inline uint32_t
+atomicSetBits (volatile uint32_t *addr, uint32_t mask)
+{
+  return __atomic_fetch_or (addr, mask, __ATOMIC_SEQ_CST);
+}
+
+static inline uint32_t
+atomicClearBits (volatile uint32_t *addr, uint32_t mask)
+{
+  return __atomic_fetch_and (addr, ~mask, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * The host fallback of the stack uses compare-and-swap, which unlike
+ * LDREX/STREX is affected by the ABA problem if nodes are popped and
+ * pushed again concurrently.
+ * */
+static inline void
+atomicStackPush (AtomicStack *stack, AtomicStackNode *node)
+{
+  AtomicStackNode *head = __atomic_load_n (&stack->head, __ATOMIC_SEQ_CST);
+  do
+    {
+      node->next = head;
+    }
+  while (!__atomic_compare_exchange_n (&stack->head, &head, node, 0,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+}
+
+static inline AtomicStackNode *
+atomicStackPop (AtomicStack *stack)
+{
+  AtomicStackNode *head = __atomic_load_n (&stack->head, __ATOMIC_SEQ_CST);
+  while (head != NULL
+         && !__atomic_compare_exchange_n (&stack->head, &head, head->next, 0,
+                                          __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+    ;
+  return head;
+}
+
+#endif
+
+/**
+ * @brief Read a word that may be written by interrupts, without a critical section.
+ */
+static inline uint32_t
+atomicLoad (volatile uint32_t *addr)
+{
+  return *addr;
+}
+
+/**
+ * @brief Write a word that may be read by interrupts, without a critical section.
+ */
+static inline void
+atomicStore (volatile uint32_t *addr, uint32_t value)
+{
+  *addr = value;
+}
+
+#endif
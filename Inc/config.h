@@ -14,6 +14,8 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#include "gpio.h"
+#include "kernel_config.h"
 #include "mcu_macros.h"
 
 /**
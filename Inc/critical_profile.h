@@ -0,0 +1,94 @@
+/**
+ * @file    critical_profile.h
+ * @brief   Critical section duration profiler for SRTOS.
+ * @details
+ * Declares the profile filled in by `systemENTER_CRITICAL()` and
+ * `systemEXIT_CRITICAL()` when `USE_CRITICAL_PROFILE` is enabled in
+ * `kernel_config.h`. Long critical sections delay SysTick_Handler and
+ * PendSV_Handler, so the profile shows which call sites cause scheduling
+ * jitter.
+ */
+
+#ifndef CRITICAL_PROFILE_H_
+#define CRITICAL_PROFILE_H_
+
+#include "kernel_config.h"
+#include "mcu_macros.h"
+#include <stdint.h>
+
+/**
+ * @brief Value of CriticalProfile.magic once the profiler is initialized.
+ */
+#define CRITICAL_PROFILE_MAGIC 0x43525450U
+
+/**
+ * @brief This struct holds the statistics of one critical section call site.
+ * 
+ * @note callSite is the return address of the systemENTER_CRITICAL () call, without the Thumb bit.
+ */
+typedef struct
+{
+  uint32_t callSite;
+  uint32_t worstCycles;
+  uint32_t count;
+} CriticalSiteRecord;
+
+/**
+ * @brief This struct is the critical section profile. Dump sizeof (CriticalProfile) bytes at &criticalProfile to decode it on the host.
+ * 
+ * @note worstSites holds the CRITICAL_PROFILE_TOP_SITES call sites with the longest single section seen. When a new call site
+ * beats the shortest of them, it replaces that entry and its count restarts at 1. Unused entries have a callSite of 0.
+ */
+typedef struct
+{
+  uint32_t magic;
+  uint32_t topSites;
+  uint32_t histogramBins;
+  uint32_t sections;
+  uint32_t histogram[CRITICAL_PROFILE_HISTOGRAM_BINS];
+  CriticalSiteRecord worstSites[CRITICAL_PROFILE_TOP_SITES];
+} CriticalProfile;
+
+#if USE_CRITICAL_PROFILE
+/**
+ * @brief The critical section profile.
+ */
+extern CriticalProfile criticalProfile;
+
+/**
+ * @brief This function will copy the profile while no critical section can update it.
+ * 
+ * @param copy The memory to copy the profile into
+ */
+void criticalProfileSnapshot (CriticalProfile *copy);
+
+/**
+ * @brief This function will clear the histogram and the call site table.
+ */
+void criticalProfileReset ();
+
+/**
+ * @brief This function will start timing a critical section.
+ * 
+ * @param callSite The address the critical section was entered from
+ * 
+ * @warning This function should not be called by user code.
+ */
+void criticalProfileEnter (uint32_t callSite);
+
+/**
+ * @brief This function will stop timing the current critical section and record it.
+ * 
+ * @warning This function should not be called by user code.
+ */
+void criticalProfileExit ();
+
+#define CRITICAL_PROFILE_ENTER(callSite)                                      \
+  criticalProfileEnter ((uint32_t)(callSite))
+#define CRITICAL_PROFILE_EXIT() criticalProfileExit ()
+#else
+#define CRITICAL_PROFILE_ENTER(callSite)
+#define CRITICAL_PROFILE_EXIT()
+#endif
+
+#endif
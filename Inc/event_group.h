@@ -0,0 +1,120 @@
+/**
+ * @file    event_group.h
+ * @brief   Event groups for SRTOS.
+ * @details
+ * An event group holds 32 event bits. Any number of tasks can block until any
+ * or all of a mask of bits are set, and setting bits wakes every waiter it
+ * satisfies in one pass, highest priority first.
+ * Setting and clearing bits never blocks, so it is safe to do from interrupts of any priority.
+ */
+
+#ifndef EVENT_GROUP_H_
+#define EVENT_GROUP_H_
+
+#include "queue.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Pass in options to wait until all bitsToWaitFor are set, instead of any of them.
+ */
+#define EVENT_WAIT_ALL 0x1U
+
+/**
+ * @brief Pass in options to clear bitsToWaitFor when the wait is satisfied.
+ */
+#define EVENT_CLEAR_ON_EXIT 0x2U
+
+/**
+ * @brief This struct records one task blocked on an event group.
+ * 
+ * @note It lives on the stack of the blocked task. The waiters are kept sorted from highest to lowest priority.
+ */
+typedef struct EventWaiter EventWaiter;
+
+struct EventWaiter
+{
+  uint32_t bitsToWaitFor;
+  uint32_t options;
+  uint32_t resultBits;
+  TaskNode *task;
+  EventWaiter *next;
+  volatile uint32_t queued;
+};
+
+/**
+ * @brief This struct is an event group of 32 event bits.
+ */
+typedef struct
+{
+  volatile uint32_t bits;
+  EventWaiter *waiters;
+} EventGroup;
+
+/**
+ * @brief Initialize an event group with every bit cleared.
+ * 
+ * @param userAllocatedEventGroup The address of the event group allocated by the user
+ * 
+ * @return Returns STATUS_SUCCESS, or STATUS_FAILURE if an argument is invalid.
+ */
+STATUS createEventGroup (EventGroup *userAllocatedEventGroup);
+
+/**
+ * @brief Set bits of an event group, waking every task whose wait is satisfied.
+ * 
+ * @param eventGroup The event group to set the bits of
+ * @param bitsToSet The bits to set
+ * 
+ * @return Returns the bits of the event group after the woken tasks' EVENT_CLEAR_ON_EXIT bits were cleared.
+ * 
+ * @note Every waiter sees the bits as they were before any of them were cleared. Interrupts are disabled while the
+ * waiters are checked, which takes time proportional to the number of waiting tasks.
+ * This function never blocks and is safe to call from interrupts of any priority.
+ */
+uint32_t eventGroupSetBits (EventGroup *eventGroup, uint32_t bitsToSet);
+
+/**
+ * @brief Clear bits of an event group.
+ * 
+ * @return Returns the bits of the event group before they were cleared.
+ * 
+ * @note This function never blocks and is safe to call from interrupts of any priority.
+ */
+uint32_t eventGroupClearBits (EventGroup *eventGroup, uint32_t bitsToClear);
+
+/**
+ * @brief Read the bits of an event group.
+ */
+uint32_t eventGroupGetBits (EventGroup *eventGroup);
+
+/**
+ * @brief Block for up to ticksToWait ms until any, or all, of bitsToWaitFor are set in an event group.
+ * 
+ * @param eventGroup The event group to wait on
+ * @param bitsToWaitFor The bits to wait for, which must not be 0
+ * @param options EVENT_WAIT_ALL and EVENT_CLEAR_ON_EXIT or'd together, or 0 to wait for any bit without clearing
+ * @param ticksToWait The number of ms to wait, 0 to return immediately, or WAIT_FOREVER
+ * 
+ * @return Returns the bits of the event group when the wait was satisfied, before EVENT_CLEAR_ON_EXIT cleared them,
+ * or the current bits if the wait timed out. Check the returned bits against bitsToWaitFor to tell which happened.
+ */
+uint32_t eventGroupWaitBits (EventGroup *eventGroup, uint32_t bitsToWaitFor,
+                             uint32_t options, uint32_t ticksToWait);
+
+#if USE_HIGH_RES_TIMER
+/**
+ * @brief Like eventGroupWaitBits (), but the timeout is usToWait microseconds, measured with getTimeUs ().
+ * 
+ * @param eventGroup The event group to wait on
+ * @param bitsToWaitFor The bits to wait for, which must not be 0
+ * @param options EVENT_WAIT_ALL and EVENT_CLEAR_ON_EXIT or'd together, or 0 to wait for any bit without clearing
+ * @param usToWait The number of microseconds to wait, below 2^31, 0 to return immediately, or WAIT_FOREVER
+ * 
+ * @return Returns the bits as eventGroupWaitBits () does.
+ */
+uint32_t eventGroupWaitBitsUs (EventGroup *eventGroup, uint32_t bitsToWaitFor,
+                               uint32_t options, uint32_t usToWait);
+#endif
+
+#endif
@@ -12,6 +12,50 @@
 #include "mcu_macros.h"
 #include <stdint.h>
 
+/**
+ * @brief Value written to the first word of every fault record. An erased record slot reads as FLASH_ERASED_WORD instead.
+ * @details The magic word is programmed after the rest of the record, so a record torn by a reset or power loss reads as
+ * FLASH_ERASED_WORD here.
+ */
+#define FAULT_RECORD_MAGIC 0x5AFE7D0CU
+
+/**
+ * @brief Value stored in FaultRecord.taskID when the fault happened before the scheduler started.
+ */
+#define FAULT_NO_TASK_ID 0xFFFFFFFFU
+
+/**
+ * @brief This struct is one entry of the fault log stored in the FAULT_DATA flash sector.
+ * @details The FAULT_DATA sector is used as an append-only ring of these records. A new record is
+ * written to the first fully erased slot. A slot whose magic is erased but whose other words are not holds a torn record and is skipped.
+ * Every field is a 32-bit word so the layout is identical on the target and in the host-side decoder (`Tools/fault_decode.py`).
+ * 
+ * @note Once every slot is used, the whole sector is erased and every earlier record is lost. sequence counts every record
+ * written since the sector was first used, so the decoder can tell how many records were erased.
+ */
+typedef struct
+{
+  uint32_t magic;
+  uint32_t r[13];
+  uint32_t sp;
+  uint32_t lr;
+  uint32_t pc;
+  uint32_t xpsr;
+  uint32_t cfsr;
+  uint32_t hfsr;
+  uint32_t mmfar;
+  uint32_t bfar;
+  uint32_t msTicksLow;
+  uint32_t msTicksHigh;
+  uint32_t taskID;
+  uint32_t sequence;
+} FaultRecord;
+
+/**
+ * @brief Number of fault records that fit in the FAULT_DATA sector.
+ */
+#define FAULT_RECORD_SLOTS (FAULT_DATA_FLASH_SIZE / sizeof (FaultRecord))
+
 /**
  * @brief Returns the Stack Pointer after a fault.
  * @param faultLR This is the link register, which will be used to return to the function's caller. It is marked unused to suppress the unused paramter compiler warning.
@@ -24,19 +68,20 @@ __attribute ((naked)) uint32_t *
 systemGet_Fault_SP (__attribute__ ((unused)) uint32_t faultLR);
 
 /**
- * @brief This function will handle a system fault. The default behavior is to log the fault SP to non-volatile memory. 
+ * @brief This function will handle a system fault. The default behavior is to append a FaultRecord to the fault log in non-volatile memory.
  * @details This function can be editted as the user needs. There is not one specific action that needs to be done here, it just depends
  * on how the user wants to handle faults.
  * 
- * @param faultSP The fault Stack Pointer that, by default, will be written to non-volatile memory. This will be the best representation of why the system faulted.
+ * @param faultSP The fault Stack Pointer, which points to the stacked exception frame (r0, r1, r2, r3, r12, lr, pc, xPSR). This will be the best representation of why the system faulted.
+ * @param calleeSavedRegs The address of r4-r11, in that order, as they were when the fault occured.
  * 
  * @warning This function must not return.
  * @warning This function should not be called by user code.
  * */
-void systemHandle_Fault (uint32_t *faultSP);
+void systemHandle_Fault (uint32_t *faultSP, uint32_t *calleeSavedRegs);
 
 /**
- * @brief This function will get the fault Stack Pointer and call the fault handler.
+ * @brief This function will get the fault Stack Pointer, save r4-r11 and call the fault handler.
  * 
  * @note This function is merely an intermediary step to the fault handler. The user should not need to change this function.
  * @warning This function should not be called by user code.
@@ -0,0 +1,91 @@
+/**
+ * @file    gpio.h
+ * @brief   GPIO access macros for every port of the STM32F411VET6.
+ * @details
+ * Ports are named by their letter (`A`, `B`, `C`, `D`, `E` or `H`) and pins by
+ * their number (0-15). Both must be compile-time constants, so each macro
+ * expands to a fixed register address and a constant mask.
+ *
+ * Output changes are written to the port's `BSRR` register. A single store to
+ * `BSRR` sets or resets only the pins whose bits are written, so tasks and
+ * interrupts can drive different pins of the same port without a critical
+ * section. `GPIOx_ODR ^= mask` reads, modifies and writes the whole port, and
+ * loses any change made to another pin between the read and the write.
+ */
+
+#ifndef GPIO_H_
+#define GPIO_H_
+
+#include <stdint.h>
+
+#include "mcu_macros.h"
+
+#define GPIO_MODE_INPUT 0U
+#define GPIO_MODE_OUTPUT 1U
+#define GPIO_MODE_ALTERNATE 2U
+#define GPIO_MODE_ANALOG 3U
+
+/**
+ * @brief Access the register at `offset` of GPIO `port`.
+ */
+#define GPIO_REG(port, offset)                                                \
+  (*((volatile uint32_t *)(GPIO##port##_START_ADDR + (offset))))
+
+/**
+ * @brief Drive `pin` of `port` high with a single store.
+ */
+#define GPIO_SET(port, pin) (GPIO_REG (port, GPIO_BSRR_OFFSET) = (1U << (pin)))
+
+/**
+ * @brief Drive `pin` of `port` low with a single store.
+ */
+#define GPIO_RESET(port, pin)                                                 \
+  (GPIO_REG (port, GPIO_BSRR_OFFSET) = (1U << ((pin) + 16U)))
+
+/**
+ * @brief Drive `pin` of `port` high if `value` is non-zero, low otherwise.
+ */
+#define GPIO_WRITE(port, pin, value)                                          \
+  (GPIO_REG (port, GPIO_BSRR_OFFSET)                                          \
+   = (value) ? (1U << (pin)) : (1U << ((pin) + 16U)))
+
+/**
+ * @brief Invert the output of `pin` of `port`.
+ * 
+ * @note The output is read from `ODR` and the new level is written with a single
+ * store to `BSRR`, so other pins of the port are never touched. Two contexts
+ * toggling the same pin at the same time can still cancel each other out.
+ */
+#define GPIO_TOGGLE(port, pin)                                                \
+  (GPIO_REG (port, GPIO_BSRR_OFFSET)                                          \
+   = (GPIO_REG (port, GPIO_ODR_OFFSET) & (1U << (pin)))                       \
+         ? (1U << ((pin) + 16U))                                              \
+         : (1U << (pin)))
+
+/**
+ * @brief Read the input level of `pin` of `port`, 1 if high and 0 if low.
+ */
+#define GPIO_READ(port, pin)                                                  \
+  ((GPIO_REG (port, GPIO_IDR_OFFSET) >> (pin)) & 1U)
+
+/**
+ * @brief Enable the AHB1 clock of `port`. Must be done before the port is used.
+ * 
+ * @warning This is a read-modify-write of `RCC_AHB1ENR`. Call it before the scheduler is started
+ * or inside a critical section.
+ */
+#define GPIO_ENABLE_CLOCK(port)                                               \
+  (RCC_AHB1ENR |= (1U << GPIO##port##_RCC_AHB1ENR_BIT))
+
+/**
+ * @brief Set the mode of `pin` of `port` to one of the `GPIO_MODE_*` values.
+ * 
+ * @warning This is a read-modify-write of the port's `MODER`. Call it before the scheduler is started
+ * or inside a critical section.
+ */
+#define GPIO_SET_MODE(port, pin, mode)                                        \
+  (GPIO_REG (port, GPIO_MODER_OFFSET)                                         \
+   = (GPIO_REG (port, GPIO_MODER_OFFSET) & ~(3U << ((pin) * 2U)))             \
+     | ((uint32_t)(mode) << ((pin) * 2U)))
+
+#endif
@@ -0,0 +1,119 @@
+/**
+ * @file    high_res_timer.h
+ * @brief   Microsecond delays for SRTOS.
+ * @details
+ * Declares delays with microsecond resolution, driven by the compare
+ * interrupt of the 32-bit TIM5 timer instead of the 1 ms SysTick. It is
+ * enabled with `USE_HIGH_RES_TIMER` in `kernel_config.h`. It also declares
+ * the deadlines that the blocking calls of queue.h and event_group.h use, so
+ * their microsecond variants share the same waiter list.
+ */
+
+#ifndef HIGH_RES_TIMER_H_
+#define HIGH_RES_TIMER_H_
+
+#include "task.h"
+#include <stdint.h>
+
+/**
+ * @brief This struct records one task blocked on the high resolution timer.
+ * 
+ * @note It lives on the stack of the blocked task. The waiters are kept sorted by wakeTimeUs,
+ * so TIM5 always compares against the earliest one.
+ */
+typedef struct HighResWaiter HighResWaiter;
+
+struct HighResWaiter
+{
+  uint32_t wakeTimeUs;
+  TaskNode *task;
+  HighResWaiter *next;
+  volatile uint32_t queued;
+};
+
+/**
+ * @brief This struct is the end of a blocking wait, either a tick count or a getTimeUs () time.
+ * 
+ * @warning This struct should not be used by user code.
+ */
+typedef struct
+{
+  uint64_t ticks;
+  uint32_t us;
+  uint32_t inUs;
+} WaitDeadline;
+
+/**
+ * @brief This function will convert a ticksToWait argument into a deadline, where 0xFFFFFFFF waits forever.
+ * 
+ * @warning This function should not be called by user code.
+ */
+WaitDeadline systemDeadlineFromTicks (uint32_t ticksToWait);
+
+/**
+ * @brief This function will return non-zero if a deadline has passed.
+ * 
+ * @warning This function should not be called by user code.
+ */
+uint32_t systemDeadlineReached (const WaitDeadline *deadline);
+
+/**
+ * @brief This function will block the current task until it is woken or the deadline passes.
+ * @details Like systemBlockCurTaskUntilWoken (), the caller must check its condition again after this returns.
+ * 
+ * @warning This function should not be called by user code.
+ */
+void systemBlockCurTaskUntilDeadline (const WaitDeadline *deadline);
+
+#if USE_HIGH_RES_TIMER
+/**
+ * @brief This function will convert a usToWait argument into a deadline, where 0xFFFFFFFF waits forever.
+ * 
+ * @warning This function should not be called by user code.
+ */
+WaitDeadline systemDeadlineFromUs (uint32_t usToWait);
+
+/**
+ * @brief This function will return the time since the scheduler was started in microseconds.
+ * 
+ * @note The value wraps around after about 71 minutes. Compare times by subtracting them.
+ */
+uint32_t getTimeUs ();
+
+/**
+ * @brief This function will block the current task for a number of microseconds.
+ * 
+ * @param usToDelay Number of microseconds to block for, below 2^31
+ * 
+ * @note Unlike taskDelay (), the wake time is not rounded to a tick. The task is made ready by the
+ * TIM5 interrupt and runs as soon as it is the highest priority ready task.
+ */
+void taskDelayUs (uint32_t usToDelay);
+
+/**
+ * @brief This function will block the current task until periodUs microseconds after its last wake time.
+ * 
+ * @param lastWakeTimeUs Address of the task's last wake time, initialize it once with getTimeUs ()
+ * @param periodUs Period of the task in microseconds, below 2^31
+ * 
+ * @note lastWakeTimeUs is advanced by periodUs on every call. If the next wake time has already passed,
+ * this returns immediately.
+ */
+void taskDelayUntilUs (uint32_t *lastWakeTimeUs, uint32_t periodUs);
+
+/**
+ * @brief This function will start TIM5 counting microseconds and enable its interrupt.
+ * 
+ * @warning This function should not be called by user code.
+ */
+void systemHighResTimerInit ();
+
+/**
+ * @brief This interrupt handler will wake every task whose high resolution wake time has passed.
+ * 
+ * @warning This function should not be called from user code.
+ */
+void TIM5_IRQHandler ();
+#endif
+
+#endif
@@ -0,0 +1,62 @@
+/**
+ * @file    job.h
+ * @brief   Run-to-completion jobs for SRTOS.
+ * @details
+ * A job is a lightweight task whose function runs from start to return every
+ * time it is triggered, either by triggerJob () or by its period elapsing.
+ * Jobs never block, so every job of one priority runs on a single shared
+ * stack owned by a dispatcher task of that priority, which is scheduled like
+ * any other task. Enabled with `USE_JOBS` in `kernel_config.h`.
+ */
+
+#ifndef JOB_H_
+#define JOB_H_
+
+#include "kernel_config.h"
+#include "task.h"
+#include <stdint.h>
+
+/**
+ * @brief This struct is a run-to-completion job. It is the only memory a job needs besides its priority level's shared stack.
+ */
+typedef struct Job Job;
+
+struct Job
+{
+  void (*jobFunc) (void);
+  uint32_t period;
+  uint64_t nextRelease;
+  volatile uint32_t pending;
+  TaskNode *dispatcher;
+  Job *next;
+};
+
+#if USE_JOBS
+/**
+ * @brief Add a job to the dispatcher of its priority level.
+ * 
+ * @param userAllocatedJob The address of the job allocated by the user
+ * @param jobFunc The address of the job function, which must return and must never block
+ * @param priority The job's priority which must be between 0 and MAX_PRIORITIES - 1, inclusive
+ * @param period The job's period in ms, or 0 for a job that only runs when triggered
+ * 
+ * @return Returns STATUS_FAILURE if an argument is invalid or more than JOB_PRIORITY_LEVELS priority levels are used, and STATUS_SUCCESS otherwise.
+ * 
+ * @note Jobs of the same priority run in the order they were created.
+ * @note Must be called before the scheduler is started.
+ */
+STATUS createJob (Job *userAllocatedJob, void (*jobFunc) (void),
+                  unsigned int priority, uint32_t period);
+
+/**
+ * @brief Request one run of a job.
+ * @details The job runs once its dispatcher is scheduled. Triggering a job again before it runs still results in a single run.
+ * 
+ * @param job The job to run
+ * 
+ * @note This function is safe to call from tasks and from interrupts of any priority.
+ */
+void triggerJob (Job *job);
+#endif
+
+#endif
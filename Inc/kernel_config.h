@@ -26,4 +26,140 @@
  */
 #define MAX_PRIORITIES 2U
 
+/**
+ * @brief Set to 1U to detect stack overflows with the Cortex-M4 MPU instead of canary values.
+ * @details
+ * When enabled, a 32 byte no-access MPU region is placed at the bottom of the
+ * incoming task's stack on every context switch. A stack overflow then causes
+ * a MemManage fault on the faulting instruction, which calls `handleStackOverflow()`,
+ * and the per-switch canary check is skipped. MemManage faults that did not hit
+ * the guard are passed to `systemHandle_Fault()`.
+ * The guard uses up to 15 words at the bottom of every task's stack.
+ */
+#define USE_MPU_STACK_GUARD 0U
+
+/**
+ * @brief Set to 1U to record scheduler events into a RAM ring buffer.
+ * @details
+ * Task creation, context switches, delays, unblocks and tick preemptions are
+ * recorded into `traceBuffer` with a `CYCCNT` timestamp. A memory dump of
+ * `traceBuffer` can be converted to Chrome trace / Perfetto JSON with
+ * `Tools/trace_to_perfetto.py`. When disabled, the trace hooks compile to nothing.
+ */
+#define USE_TRACE 0U
+
+/**
+ * @brief Number of 8 byte records in the trace ring buffer. Must be a power of 2.
+ */
+#define TRACE_BUFFER_RECORDS 256U
+
+/**
+ * @brief Set to 1U to enable the deferred interrupt work queue.
+ * @details
+ * ISRs post work with `workQueuePostFromISR()`, and a kernel worker task
+ * runs every posted function outside of interrupt context.
+ */
+#define USE_WORK_QUEUE 0U
+
+/**
+ * @brief Number of work items the work queue can hold. Must be a power of 2, and at least 2.
+ */
+#define WORK_QUEUE_LENGTH 16U
+
+/**
+ * @brief Priority of the work queue's worker task.
+ */
+#define WORK_QUEUE_TASK_PRIORITY (MAX_PRIORITIES - 1U)
+
+/**
+ * @brief Stack size of the work queue's worker task, in 32-bit words.
+ */
+#define WORK_QUEUE_STACK_SIZE STACK_SIZE
+
+/**
+ * @brief Set to 1U to enable run-to-completion jobs.
+ * @details
+ * Jobs are lightweight tasks that run from start to return every time they
+ * are triggered. All jobs of one priority share a single STACK_SIZE stack.
+ */
+#define USE_JOBS 0U
+
+/**
+ * @brief Number of distinct priority levels that can hold jobs.
+ * @details
+ * Each level used by a job costs one shared stack of STACK_SIZE words.
+ */
+#define JOB_PRIORITY_LEVELS 1U
+
+/**
+ * @brief Set to 1U to enable deadline monitoring of periodic tasks.
+ * @details
+ * Tasks registered with `setTaskDeadline()` have their response times and
+ * deadline misses recorded every time they call `taskDelayUntil()`.
+ */
+#define USE_DEADLINE_MONITOR 0U
+
+/**
+ * @brief Set to 1U to run the scheduler hot paths and the vector table from SRAM.
+ * @details
+ * SysTick_Handler, PendSV_Handler, the ready and blocked list operations and
+ * the critical section functions are copied to SRAM at startup, and VTOR is
+ * pointed at a copy of the vector table in SRAM, so none of them wait on
+ * flash wait states. `make RAM_EXEC=1` sets this without editing this file.
+ */
+#ifndef USE_RAM_EXECUTION
+#define USE_RAM_EXECUTION 0U
+#endif
+
+/**
+ * @brief Set to 1U to measure how long every critical section masks the scheduler.
+ * @details
+ * Every `systemENTER_CRITICAL()`/`systemEXIT_CRITICAL()` pair is timed with
+ * `CYCCNT`. `criticalProfile` keeps a histogram of the durations and the call
+ * sites with the longest ones. It can be read at runtime or decoded from a
+ * memory dump with `Tools/critical_profile_decode.py`. When disabled, the
+ * profiling hooks compile to nothing.
+ */
+#define USE_CRITICAL_PROFILE 0U
+
+/**
+ * @brief Number of worst call sites kept by the critical section profiler.
+ */
+#define CRITICAL_PROFILE_TOP_SITES 8U
+
+/**
+ * @brief Number of histogram bins of the critical section profiler.
+ * @details
+ * Bin i counts sections that lasted 2^i to 2^(i + 1) - 1 cycles, and the last
+ * bin also counts every longer section.
+ */
+#define CRITICAL_PROFILE_HISTOGRAM_BINS 16U
+
+/**
+ * @brief Set to 1U to enable microsecond delays on the 32-bit TIM5 timer.
+ * @details
+ * TIM5 counts microseconds and its compare interrupt wakes tasks blocked in
+ * `taskDelayUs()` or `taskDelayUntilUs()`, or waiting in one of the
+ * microsecond timeout variants of the queue and event group calls,
+ * independently of the 1 ms SysTick.
+ */
+#define USE_HIGH_RES_TIMER 0U
+
+/**
+ * @brief Input clock of TIM5 in Hz. Must be a multiple of 1 MHz.
+ * @details
+ * With the default clock configuration SYSCLK is the 8 MHz HSE and the APB1
+ * prescaler is 1, so TIM5 runs at 8 MHz.
+ */
+#define HIGH_RES_TIMER_CLOCK_HZ 8000000U
+
+/**
+ * @brief Set to 1U to enable per-task preemption thresholds.
+ * @details
+ * A running task whose threshold is set with `setTaskPreemptionThreshold()`
+ * can only be preempted by tasks with a priority above its threshold, and is
+ * not time sliced with tasks of its own priority.
+ */
+#define USE_PREEMPTION_THRESHOLD 0U
+
 #endif
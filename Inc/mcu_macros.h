@@ -9,11 +9,28 @@
 #ifndef MCU_MACROS_H_
 #define MCU_MACROS_H_
 
+#define GPIOA_START_ADDR 0x40020000
+#define GPIOB_START_ADDR 0x40020400
+#define GPIOC_START_ADDR 0x40020800
 #define GPIOD_START_ADDR 0x40020C00
+#define GPIOE_START_ADDR 0x40021000
+#define GPIOH_START_ADDR 0x40021C00
+#define GPIOA_RCC_AHB1ENR_BIT 0
+#define GPIOB_RCC_AHB1ENR_BIT 1
+#define GPIOC_RCC_AHB1ENR_BIT 2
+#define GPIOD_RCC_AHB1ENR_BIT 3
+#define GPIOE_RCC_AHB1ENR_BIT 4
+#define GPIOH_RCC_AHB1ENR_BIT 7
+#define GPIO_MODER_OFFSET 0x00
+#define GPIO_IDR_OFFSET 0x10
+#define GPIO_ODR_OFFSET 0x14
+#define GPIO_BSRR_OFFSET 0x18
 #define RCC_START_ADDR 0x40023800
 #define RCC_AHB1ENR *((volatile uint32_t *)(RCC_START_ADDR + 0x30))
 #define GPIOD_MODER *((volatile uint32_t *)GPIOD_START_ADDR)
 #define GPIOD_ODR *((volatile uint32_t *)(GPIOD_START_ADDR + 0x14))
+#define RCC_APB1ENR *((volatile uint32_t *)(RCC_START_ADDR + 0x40))
+#define RCC_APB1ENR_TIM5EN_BIT 3
 #define RCC_CR *((volatile uint32_t *)(RCC_START_ADDR))
 #define RCC_CFGR *((volatile uint32_t *)(RCC_START_ADDR + 0x08))
 #define SYSTICK_CSR *((volatile uint32_t *)(0xE000E010))
@@ -38,5 +55,62 @@
 #define FLASH_CR_STRT_BIT 16
 #define FLASH_CR_PG_BIT 0
 #define FAULT_DATA_FLASH_START_ADDR 0x08060000
+#define FAULT_DATA_FLASH_SIZE 0x20000
+#define FLASH_ERASED_WORD 0xFFFFFFFF
+#define SCB_VTOR *((volatile uint32_t *)(0xE000ED08))
+#define VECTOR_TABLE_WORDS 102U
+#define VECTOR_TABLE_ALIGNMENT 512U
+#define SCB_CFSR *((volatile uint32_t *)(0xE000ED28))
+#define SCB_CFSR_DACCVIOL_BIT 1
+#define SCB_CFSR_MSTKERR_BIT 4
+#define SCB_CFSR_MMARVALID_BIT 7
+#define EXCEPTION_FRAME_MAX_BYTES 108U
+#define SCB_HFSR *((volatile uint32_t *)(0xE000ED2C))
+#define SCB_MMFAR *((volatile uint32_t *)(0xE000ED34))
+#define SCB_BFAR *((volatile uint32_t *)(0xE000ED38))
+#define SCB_SHCSR *((volatile uint32_t *)(0xE000ED24))
+#define SCB_SHCSR_MEMFAULTENA_BIT 16
+#define MPU_CTRL *((volatile uint32_t *)(0xE000ED94))
+#define MPU_CTRL_ENABLE_BIT 0
+#define MPU_CTRL_PRIVDEFENA_BIT 2
+#define MPU_RNR *((volatile uint32_t *)(0xE000ED98))
+#define MPU_RBAR *((volatile uint32_t *)(0xE000ED9C))
+#define MPU_RBAR_VALID_BIT 4
+#define MPU_RASR *((volatile uint32_t *)(0xE000EDA0))
+#define MPU_RASR_ENABLE_BIT 0
+#define MPU_RASR_SIZE_BIT_START 1
+#define MPU_RASR_XN_BIT 28
+#define MPU_STACK_GUARD_REGION 7U
+#define MPU_STACK_GUARD_SIZE_BYTES 32U
+#define DEMCR *((volatile uint32_t *)(0xE000EDFC))
+#define DEMCR_TRCENA_BIT 24
+#define DWT_CTRL *((volatile uint32_t *)(0xE0001000))
+#define DWT_CTRL_CYCCNTENA_BIT 0
+#define DWT_CYCCNT *((volatile uint32_t *)(0xE0001004))
+
+#define TIM5_START_ADDR 0x40000C00
+#define TIM5_CR1 *((volatile uint32_t *)(TIM5_START_ADDR + 0x00))
+#define TIM5_DIER *((volatile uint32_t *)(TIM5_START_ADDR + 0x0C))
+#define TIM5_SR *((volatile uint32_t *)(TIM5_START_ADDR + 0x10))
+#define TIM5_EGR *((volatile uint32_t *)(TIM5_START_ADDR + 0x14))
+#define TIM5_CNT *((volatile uint32_t *)(TIM5_START_ADDR + 0x24))
+#define TIM5_PSC *((volatile uint32_t *)(TIM5_START_ADDR + 0x28))
+#define TIM5_ARR *((volatile uint32_t *)(TIM5_START_ADDR + 0x2C))
+#define TIM5_CCR1 *((volatile uint32_t *)(TIM5_START_ADDR + 0x34))
+#define TIM_CR1_CEN_BIT 0
+#define TIM_DIER_UIE_BIT 0
+#define TIM_DIER_CC1IE_BIT 1
+#define TIM_SR_UIF_BIT 0
+#define TIM_SR_CC1IF_BIT 1
+#define TIM_EGR_UG_BIT 0
+#define TIM5_IRQ_NUMBER 50U
+#define NVIC_ISER_START_ADDR 0xE000E100
+#define NVIC_ISPR_START_ADDR 0xE000E200
+#define NVIC_IPR_START_ADDR 0xE000E400
+#define NVIC_ISER(irq)                                                        \
+  *((volatile uint32_t *)(NVIC_ISER_START_ADDR + 4U * ((irq) / 32U)))
+#define NVIC_ISPR(irq)                                                        \
+  *((volatile uint32_t *)(NVIC_ISPR_START_ADDR + 4U * ((irq) / 32U)))
+#define NVIC_IPR(irq) *((volatile uint8_t *)(NVIC_IPR_START_ADDR + (irq)))
 
 #endif
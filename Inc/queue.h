@@ -0,0 +1,233 @@
+/**
+ * @file    queue.h
+ * @brief   Message queues, semaphores and queue sets for SRTOS.
+ * @details
+ * Provides counting semaphores and queues of 32-bit items that tasks can block on,
+ * and queue sets that let one task block on many of them at once.
+ * Giving a semaphore and sending to a queue never block, so they are safe to call from interrupts of any priority.
+ */
+
+#ifndef QUEUE_H_
+#define QUEUE_H_
+
+#include "task.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Pass as ticksToWait to block until the operation succeeds.
+ */
+#define WAIT_FOREVER 0xFFFFFFFFU
+
+typedef struct QueueSet QueueSet;
+
+/**
+ * @brief This struct records one task blocked on a semaphore, queue or queue set.
+ * 
+ * @note It lives on the stack of the blocked task. The waiters are kept sorted from highest to lowest priority.
+ */
+typedef struct ObjectWaiter ObjectWaiter;
+
+struct ObjectWaiter
+{
+  TaskNode *task;
+  ObjectWaiter *next;
+  volatile uint32_t queued;
+};
+
+/**
+ * @brief This struct is the part every object that can be added to a queue set starts with.
+ * 
+ * @note Any number of tasks may block on an object. Each give or send wakes the highest priority one.
+ * setEntries counts the entries of the object in its set's ready FIFO, which is never more than the items it holds.
+ */
+typedef struct
+{
+  QueueSet *set;
+  ObjectWaiter *waiters;
+  uint32_t setEntries;
+} KernelObject;
+
+/**
+ * @brief This struct is a counting semaphore.
+ */
+typedef struct
+{
+  KernelObject object;
+  uint32_t count;
+  uint32_t maxCount;
+} Semaphore;
+
+/**
+ * @brief This struct is a FIFO queue of 32-bit items stored in a user-allocated buffer.
+ */
+typedef struct
+{
+  KernelObject object;
+  uint32_t *buffer;
+  uint32_t length;
+  uint32_t head;
+  uint32_t count;
+} Queue;
+
+/**
+ * @brief This struct is a queue set. It holds a FIFO of the members that became ready, so waking its task costs the same
+ * no matter how many members it has.
+ */
+struct QueueSet
+{
+  void **readyMembers;
+  uint32_t length;
+  uint32_t capacityUsed;
+  uint32_t head;
+  uint32_t count;
+  ObjectWaiter *waiters;
+};
+
+/**
+ * @brief Initialize a counting semaphore.
+ * 
+ * @param userAllocatedSemaphore The address of the semaphore allocated by the user
+ * @param initialCount The count the semaphore starts with
+ * @param maxCount The highest count the semaphore can reach, which must not be 0
+ * 
+ * @return Returns STATUS_SUCCESS, or STATUS_FAILURE if an argument is invalid.
+ */
+STATUS createSemaphore (Semaphore *userAllocatedSemaphore,
+                        uint32_t initialCount, uint32_t maxCount);
+
+/**
+ * @brief Increment a semaphore's count, waking the highest priority task waiting on it and, if it is in a queue set, the
+ * highest priority task waiting on the set.
+ * 
+ * @return Returns STATUS_SUCCESS, or STATUS_FAILURE if the count is already maxCount.
+ * 
+ * @note This function never blocks and is safe to call from interrupts of any priority.
+ */
+STATUS semaphoreGive (Semaphore *semaphore);
+
+/**
+ * @brief Decrement a semaphore's count, blocking for up to ticksToWait ms until it is above 0.
+ * 
+ * @param semaphore The semaphore to take
+ * @param ticksToWait The number of ms to wait, 0 to return immediately, or WAIT_FOREVER
+ * 
+ * @return Returns STATUS_SUCCESS if the semaphore was taken, and STATUS_FAILURE if the wait timed out.
+ */
+STATUS semaphoreTake (Semaphore *semaphore, uint32_t ticksToWait);
+
+#if USE_HIGH_RES_TIMER
+/**
+ * @brief Like semaphoreTake (), but the timeout is usToWait microseconds, measured with getTimeUs ().
+ * 
+ * @param semaphore The semaphore to take
+ * @param usToWait The number of microseconds to wait, below 2^31, 0 to return immediately, or WAIT_FOREVER
+ * 
+ * @return Returns STATUS_SUCCESS if the semaphore was taken, and STATUS_FAILURE if the wait timed out.
+ */
+STATUS semaphoreTakeUs (Semaphore *semaphore, uint32_t usToWait);
+#endif
+
+/**
+ * @brief Initialize a queue.
+ * 
+ * @param userAllocatedQueue The address of the queue allocated by the user
+ * @param buffer The user-allocated array that stores the queue's items
+ * @param length The number of items buffer can hold, which must not be 0
+ * 
+ * @return Returns STATUS_SUCCESS, or STATUS_FAILURE if an argument is invalid.
+ */
+STATUS createQueue (Queue *userAllocatedQueue, uint32_t buffer[],
+                    uint32_t length);
+
+/**
+ * @brief Add an item to the back of a queue, waking the highest priority task waiting on it and, if it is in a queue set,
+ * the highest priority task waiting on the set.
+ * 
+ * @return Returns STATUS_SUCCESS, or STATUS_FAILURE if the queue is full.
+ * 
+ * @note This function never blocks and is safe to call from interrupts of any priority.
+ */
+STATUS queueSend (Queue *queue, uint32_t item);
+
+/**
+ * @brief Remove the item at the front of a queue, blocking for up to ticksToWait ms until there is one.
+ * 
+ * @param queue The queue to receive from
+ * @param item The address the received item is written to
+ * @param ticksToWait The number of ms to wait, 0 to return immediately, or WAIT_FOREVER
+ * 
+ * @return Returns STATUS_SUCCESS if an item was received, and STATUS_FAILURE if the wait timed out.
+ */
+STATUS queueReceive (Queue *queue, uint32_t *item, uint32_t ticksToWait);
+
+#if USE_HIGH_RES_TIMER
+/**
+ * @brief Like queueReceive (), but the timeout is usToWait microseconds, measured with getTimeUs ().
+ * 
+ * @param queue The queue to receive from
+ * @param item The address the received item is written to
+ * @param usToWait The number of microseconds to wait, below 2^31, 0 to return immediately, or WAIT_FOREVER
+ * 
+ * @return Returns STATUS_SUCCESS if an item was received, and STATUS_FAILURE if the wait timed out.
+ */
+STATUS queueReceiveUs (Queue *queue, uint32_t *item, uint32_t usToWait);
+#endif
+
+/**
+ * @brief Initialize a queue set.
+ * 
+ * @param userAllocatedQueueSet The address of the queue set allocated by the user
+ * @param buffer The user-allocated array that stores the members that became ready
+ * @param length The number of entries in buffer. It must be at least the sum of the lengths of the member queues and the maxCounts of the member semaphores.
+ * 
+ * @return Returns STATUS_SUCCESS, or STATUS_FAILURE if an argument is invalid.
+ */
+STATUS createQueueSet (QueueSet *userAllocatedQueueSet, void *buffer[],
+                       uint32_t length);
+
+/**
+ * @brief Add a semaphore to a queue set.
+ * 
+ * @return Returns STATUS_SUCCESS, or STATUS_FAILURE if the semaphore is already in a set, its count is not 0, or the set's buffer is too small.
+ * 
+ * @note Must be called before the semaphore is used.
+ */
+STATUS queueSetAddSemaphore (QueueSet *queueSet, Semaphore *semaphore);
+
+/**
+ * @brief Add a queue to a queue set.
+ * 
+ * @return Returns STATUS_SUCCESS, or STATUS_FAILURE if the queue is already in a set, it is not empty, or the set's buffer is too small.
+ * 
+ * @note Must be called before the queue is used.
+ */
+STATUS queueSetAddQueue (QueueSet *queueSet, Queue *queue);
+
+/**
+ * @brief Block for up to ticksToWait ms until a member of the queue set is ready.
+ * @details Every semaphoreGive () and queueSend () on a member adds the member to the set once, so after this function returns
+ * the member, one semaphoreTake () or queueReceive () with a ticksToWait of 0 on it will succeed, unless another task took
+ * the item directly in the meantime. Taking an item directly from a member removes one of its entries from the set if it
+ * has more entries than items left, so the set never returns a member for an item that is already gone.
+ * 
+ * @param queueSet The queue set to wait on
+ * @param ticksToWait The number of ms to wait, 0 to return immediately, or WAIT_FOREVER
+ * 
+ * @return Returns the address of the Semaphore or Queue that is ready, or NULL if the wait timed out.
+ */
+void *queueSetSelect (QueueSet *queueSet, uint32_t ticksToWait);
+
+#if USE_HIGH_RES_TIMER
+/**
+ * @brief Like queueSetSelect (), but the timeout is usToWait microseconds, measured with getTimeUs ().
+ * 
+ * @param queueSet The queue set to wait on
+ * @param usToWait The number of microseconds to wait, below 2^31, 0 to return immediately, or WAIT_FOREVER
+ * 
+ * @return Returns the address of the Semaphore or Queue that is ready, or NULL if the wait timed out.
+ */
+void *queueSetSelectUs (QueueSet *queueSet, uint32_t usToWait);
+#endif
+
+#endif
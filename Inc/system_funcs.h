@@ -10,7 +10,23 @@
 
 #include <stdint.h>
 
+#include "kernel_config.h"
+
+/**
+ * @brief Place a function in SRAM when USE_RAM_EXECUTION is enabled.
+ * @details The startup code copies the `.RamFunc` section to SRAM along with `.data`.
+ * Calls between flash and SRAM are out of range of a `BL`, so the linker inserts
+ * long branch veneers for them.
+ */
+#if USE_RAM_EXECUTION
+#define RAMFUNC __attribute__ ((section (".RamFunc"), noinline))
+#else
+#define RAMFUNC
+#endif
+
 void systemENTER_CRITICAL ();
 void systemEXIT_CRITICAL ();
+uint32_t systemENTER_CRITICAL_FROM_ISR ();
+void systemEXIT_CRITICAL_FROM_ISR (uint32_t savedPRIMASK);
 
 #endif
@@ -24,6 +24,28 @@ typedef enum
   STATUS_FAILURE = 1
 } STATUS;
 
+/**
+ * @brief This struct stores the deadline and response time statistics of a periodic task.
+ * @details The task's first job is released when it is first switched in. Every later job is released at a taskDelayUntil ()
+ * wake time and completes at the task's next call to taskDelayUntil (). All times are in ms.
+ * periodMismatchCount counts the taskDelayUntil () calls whose period differs from the registered one.
+ */
+typedef struct
+{
+  uint32_t period;
+  uint32_t relativeDeadline;
+  uint64_t releaseTime;
+  uint64_t absoluteDeadline;
+  uint32_t released;
+  uint32_t missFlagged;
+  uint32_t missCount;
+  uint32_t periodMismatchCount;
+  uint32_t completedJobs;
+  uint32_t worstResponseTime;
+  uint32_t bestResponseTime;
+  uint32_t jitter;
+} DeadlineMonitor;
+
 /**
  * @brief This struct is the Task Control Block (TCB), which is what stores a task's properties.
  */
@@ -32,10 +54,55 @@ typedef struct
   uint32_t *sp;
   uint32_t priority;
   uint32_t id;
-  uint32_t delayedUntil;
+  uint64_t delayedUntil;
   uint32_t *stackFrameLowerBoundAddr;
+  volatile uint32_t wakeRequested;
+  uint32_t waitingForWake;
+#if USE_MPU_STACK_GUARD
+  uint32_t stackGuardRBAR;
+#endif
+#if USE_DEADLINE_MONITOR
+  DeadlineMonitor *deadlineMonitor;
+#endif
+#if USE_PREEMPTION_THRESHOLD
+  uint32_t basePriority;
+  uint32_t preemptionThreshold;
+#endif
 } TCB;
 
+/**
+ * @brief The priority a task was created with.
+ * @details With USE_PREEMPTION_THRESHOLD, TCB.priority holds the threshold while the task runs above its priority, so waiter
+ * lists and trace records use this instead.
+ */
+#if USE_PREEMPTION_THRESHOLD
+#define systemTASK_BASE_PRIORITY(tcb) ((tcb)->basePriority)
+#else
+#define systemTASK_BASE_PRIORITY(tcb) ((tcb)->priority)
+#endif
+
+/**
+ * @brief Bits of TCB.wakeRequested.
+ * @details WAKE_PREEMPTS_EQUAL lets the woken task preempt a task of its own priority instead of waiting for its time slice.
+ */
+#define WAKE_REQUESTED 1U
+#define WAKE_PREEMPTS_EQUAL 2U
+
+/**
+ * @brief Value of TCB.delayedUntil for a task that is blocked until it is woken by systemWakeTaskFromISR ().
+ */
+#define DELAYED_FOREVER UINT64_MAX
+
+/**
+ * @brief The smallest stack in words that createTask () and TASK_DEFINE () accept.
+ * @details It holds the initial stack frame, plus the worst case alignment padding and guard region when USE_MPU_STACK_GUARD is enabled.
+ */
+#if USE_MPU_STACK_GUARD
+#define MIN_STACK_SIZE (18U + 15U)
+#else
+#define MIN_STACK_SIZE 18U
+#endif
+
 /**
  * @brief This struct is used to represent a task in a linked list.
  */
@@ -50,9 +117,19 @@ struct TaskNode
 /**
  * @brief msTicks contains the amount of ticks that have occured since the scheduler started.
  * 
+ * @note msTicks is 64 bits wide so it will not wrap around during the lifetime of the system.
+ * A 64-bit read is not atomic on the ARM-Cortex M4, so use getTickCount () to read it from a task.
+ * 
  * @warning User code should rarely, if ever, access this variable.
  */
-extern volatile uint32_t msTicks;
+extern volatile uint64_t msTicks;
+
+/**
+ * @brief curTask is the TaskNode of the task that is currently executing. It is NULL until the scheduler is started.
+ * 
+ * @warning This variable should never be accessed in user code.
+ */
+extern TaskNode *curTask;
 
 /**
  * @brief This is a list of linked lists that contain the ready tasks.
@@ -84,6 +161,48 @@ createTask (uint32_t taskStack[], void (*taskFunc) (void),
             unsigned int priority, TCB *userAllocatedTCB,
             TaskNode *userAllocatedTaskNode);
 
+/**
+ * @brief Statically define a task that is added to the scheduler when startScheduler () is called.
+ * @details This defines `name##Stack`, `name##TCB` and `name##Node`. The stack is fully initialized at compile time
+ * (initial stack frame, canary values and usage watermarks) and the TCB points at it, so no per-task setup is done at runtime.
+ * `name##Node` is placed in the `.task_table` linker section, which startScheduler () walks to add each task to the ready list.
+ * Tasks defined this way are added after the tasks created with createTask (), in link order.
+ * 
+ * @param name The name prefix of the task's stack, TCB and TaskNode
+ * @param taskFunc The task function, which must be declared before this macro is used
+ * @param taskPriority The task's priority which must be between 0 and MAX_PRIORITIES - 1, inclusive
+ * @param stackWords The size of the task's stack in words
+ * 
+ * @note Invalid priorities and stack sizes are compile time errors.
+ * @note Must be used at file scope.
+ */
+#define TASK_DEFINE(name, taskFunc, taskPriority, stackWords)                 \
+  _Static_assert ((taskPriority) < MAX_PRIORITIES,                            \
+                  #name ": priority must be below MAX_PRIORITIES");           \
+  _Static_assert ((stackWords) >= MIN_STACK_SIZE,                            \
+                  #name ": stack must hold at least MIN_STACK_SIZE words");  \
+  /* The watermark fills the whole stack first, so a minimum size stack   \
+     with no words between the canaries and the frame still compiles */     \
+  _Pragma ("GCC diagnostic push")                                             \
+  _Pragma ("GCC diagnostic ignored \"-Woverride-init\"")                     \
+  __extension__ uint32_t name##Stack[(stackWords)] = {                        \
+    [0 ...(stackWords) - 1] = STACK_USAGE_WATERMARK,                          \
+    [0] = STACK_OVERFLOW_CANARY_VALUE,                                        \
+    [1] = STACK_OVERFLOW_CANARY_VALUE,                                        \
+    [(stackWords) - 16 ...(stackWords) - 4] = 0x00000000, /* R4-R11, R0-R3, R12 */ \
+    [(stackWords) - 3] = 0xFFFFFFFD,                      /* LR */            \
+    [(stackWords) - 2] = (uint32_t)(taskFunc),            /* PC */            \
+    [(stackWords) - 1] = 0x01000000,                      /* xPSR */          \
+  };                                                                          \
+  _Pragma ("GCC diagnostic pop")                                              \
+  TCB name##TCB = {                                                           \
+    .sp = &name##Stack[(stackWords) - 16],                                    \
+    .priority = (taskPriority),                                               \
+    .stackFrameLowerBoundAddr = &name##Stack[0],                              \
+  };                                                                          \
+  TaskNode name##Node __attribute__ ((section (".task_table"), used))         \
+  = { &name##TCB, NULL }
+
 void SysTick_Handler ();
 void PendSV_Handler ();
 void SVC_Handler ();
@@ -103,9 +222,99 @@ void startScheduler ();
  * If there are no other tasks available to execute, the idleTask will execute.
  * 
  * @param ticksToDelay The number of milliseconds to delay a task's execution.
+ * 
+ * @note A ticksToDelay of 0 will return immediately without blocking.
  */
 void taskDelay (uint32_t ticksToDelay);
 
+/**
+ * @brief This function will delay a task's execution until period ms after *lastWakeTime.
+ * @details This function is used to create periodic tasks that release on exact tick boundaries.
+ * Unlike taskDelay (), the time spent executing the task does not add to the period, so the release time does not drift.
+ * *lastWakeTime is advanced by period on every call. If the next release time has already passed, the function returns immediately.
+ * 
+ * @param lastWakeTime The address of a variable holding the last release time of the task. Initialize it once with getTickCount () before the task's loop.
+ * @param period The period of the task in ms.
+ * 
+ * @note taskDelayUntil () should not be called with a period of 0.
+ */
+void taskDelayUntil (uint64_t *lastWakeTime, uint32_t period);
+
+#if USE_DEADLINE_MONITOR
+/**
+ * @brief Register the period and relative deadline of a periodic task.
+ * @details The task's first job is released when the task is first switched in, and every later job at the wake time of its taskDelayUntil () call.
+ * When a job has not completed relativeDeadline ms after its release, the miss is counted once and deadlineMissHook () is called.
+ * The checks are done on the current task in SysTick_Handler, on the incoming task in PendSV_Handler, and on completion, so they take constant time.
+ * 
+ * @param task The TCB of the task, which must already be created
+ * @param userAllocatedMonitor The address of the task's DeadlineMonitor allocated by the user, which holds the statistics
+ * @param period The task's period in ms, which must not be 0. Every taskDelayUntil () call with a different period is counted in periodMismatchCount.
+ * @param relativeDeadline The deadline of each job in ms after its release, which must not be 0
+ * 
+ * @return Returns STATUS_SUCCESS, or STATUS_FAILURE if an argument is invalid.
+ * 
+ * @note Must be called before the scheduler is started.
+ */
+STATUS setTaskDeadline (TCB *task, DeadlineMonitor *userAllocatedMonitor,
+                        uint32_t period, uint32_t relativeDeadline);
+
+/**
+ * @brief This function will be called once for every job that misses its deadline.
+ * This function will only be called if no other definitions are found.
+ * 
+ * @param task The TCB of the task that missed its deadline.
+ * 
+ * @note This may be called from SysTick_Handler or PendSV_Handler, so it must be short and must not block.
+ */
+void deadlineMissHook (TCB *task);
+#endif
+
+/**
+ * @brief This function will return the amount of ticks that have occured since the scheduler started.
+ * 
+ * @return Returns the current value of msTicks.
+ * 
+ * @note This function reads the high half, the low half and then the high half of msTicks again, and retries if the high half
+ * changed, so the 64-bit value can not tear without masking interrupts.
+ */
+uint64_t getTickCount ();
+
+/**
+ * @brief This function will block the current task until it is woken by systemWakeTaskFromISR (), or until msTicks reaches wakeTime.
+ * @details If a wake was already requested since the task last blocked, the request is consumed and the function returns immediately,
+ * so a wake that happens between the task checking its condition and calling this function is never lost.
+ * The function also returns immediately if wakeTime has already passed.
+ * 
+ * @param wakeTime The value of msTicks at which the task is unblocked if it was not woken, or DELAYED_FOREVER.
+ * 
+ * @warning This function should not be called by user code. It is used by kernel objects such as the work queue.
+ */
+void systemBlockCurTaskUntilWoken (uint64_t wakeTime);
+
+/**
+ * @brief This function will request that a task blocked by systemBlockCurTaskUntilWoken () is moved back to the ready list.
+ * @details The request is recorded with a flag and handled in PendSV_Handler, so this function never touches the kernel lists
+ * and is safe to call from an interrupt of any priority. A request for a task blocked in taskDelay () or taskDelayUntil ()
+ * is discarded, so it can not end the delay early.
+ * 
+ * @param task The TaskNode of the task to wake.
+ * 
+ * @warning This function should not be called by user code. It is used by kernel objects such as the work queue.
+ */
+void systemWakeTaskFromISR (TaskNode *task);
+
+/**
+ * @brief Like systemWakeTaskFromISR (), but the woken task also preempts a running or resuming task of equal priority.
+ * @details Used for timed wakes, so an equal priority task does not add up to one time slice of jitter to the wake time.
+ * A task running above its priority at a preemption threshold is still only preempted by a higher priority.
+ * 
+ * @param task The TaskNode of the task to wake.
+ * 
+ * @warning This function should not be called by user code.
+ */
+void systemWakeTaskFromISRAndPreempt (TaskNode *task);
+
 /**
  * @brief This function will return the minimum number of words left on the stack.
  * 
@@ -119,7 +328,53 @@ uint32_t getCurTaskWordsAvailable ();
  * @brief This function will be called when a stack overflow is detected.
  * This function will only be called if no other definitions are found.
  * The user is recommended to define this themselves.
+ * 
+ * @param overflowedTask The TCB of the task whose stack overflowed.
+ * 
+ * @note With USE_MPU_STACK_GUARD, the fault is passed to systemHandle_Fault () if this function returns.
+ */
+void handleStackOverflow (TCB *overflowedTask);
+
+#if USE_PREEMPTION_THRESHOLD
+/**
+ * @brief Set the preemption threshold of a task.
+ * @details Once the task has started running, it runs at its threshold instead of its priority until it blocks, so only tasks
+ * with a priority above the threshold can preempt it, and it is not time sliced. Tasks that never preempt each other can share
+ * data without critical sections, and fewer preemptions mean fewer context switches.
+ * 
+ * @param task The TCB of the task, which must already be created
+ * @param threshold The preemption threshold, from the task's priority to MAX_PRIORITIES - 1
+ * 
+ * @return Returns STATUS_SUCCESS, or STATUS_FAILURE if an argument is invalid.
+ * 
+ * @note Must be called before the scheduler is started. While a task runs above its priority, its TCB priority holds the threshold.
  */
-void handleStackOverflow ();
+STATUS setTaskPreemptionThreshold (TCB *task, uint32_t threshold);
+#endif
+
+#if USE_MPU_STACK_GUARD
+/**
+ * @brief This function will report a MemManage fault as a stack overflow if it hit the current task's stack guard,
+ * then pass the fault to systemHandle_Fault ().
+ * @details A data access fault counts when MMFAR is valid and inside the guard. A fault while stacking an exception frame
+ * counts when the task's stack pointer is within EXCEPTION_FRAME_MAX_BYTES of the guard, since MMFAR is not valid for
+ * stacking faults.
+ * 
+ * @param faultSP The fault Stack Pointer, as passed to systemHandle_Fault ().
+ * @param calleeSavedRegs The address of r4-r11, in that order, as they were when the fault occured.
+ * 
+ * @warning This function must not return, since that would retry the faulting access.
+ * @warning This function should not be called by user code.
+ */
+void systemHandle_MemManage (uint32_t *faultSP, uint32_t *calleeSavedRegs);
+
+/**
+ * @brief This interrupt handler will get the fault Stack Pointer, save r4-r11 and call systemHandle_MemManage ().
+ * 
+ * @note This handler never returns.
+ * @warning This function should not be called from user code.
+ */
+__attribute__ ((naked)) void MemManage_Handler ();
+#endif
 
 #endif
@@ -0,0 +1,82 @@
+/**
+ * @file    trace.h
+ * @brief   Scheduler event trace recorder for SRTOS.
+ * @details
+ * Declares the trace ring buffer and the hooks the kernel uses to record
+ * scheduler events. Tracing is enabled with `USE_TRACE` in `kernel_config.h`.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include "kernel_config.h"
+#include "task.h"
+#include <stdint.h>
+
+/**
+ * @brief Value of TraceBuffer.magic once the trace recorder is initialized.
+ */
+#define TRACE_BUFFER_MAGIC 0x54524345U
+
+/**
+ * @brief This enum lists the scheduler events that can be recorded.
+ */
+typedef enum
+{
+  TRACE_EVENT_TASK_CREATE = 0,
+  TRACE_EVENT_TASK_SWITCH_IN = 1,
+  TRACE_EVENT_TASK_DELAY = 2,
+  TRACE_EVENT_TASK_UNBLOCK = 3,
+  TRACE_EVENT_TICK_PREEMPT = 4
+} TRACE_EVENT;
+
+/**
+ * @brief This struct is one 8 byte trace record.
+ * 
+ * @note timestamp is the value of the DWT cycle counter (CYCCNT) when the event was recorded.
+ */
+typedef struct
+{
+  uint32_t timestamp;
+  uint8_t event;
+  uint8_t priority;
+  uint16_t taskID;
+} TraceRecord;
+
+/**
+ * @brief This struct is the trace ring buffer. Dump sizeof (TraceBuffer) bytes at &traceBuffer to decode it on the host.
+ * 
+ * @note writeIndex is the total number of records ever written. The next record is written to records[writeIndex % TRACE_BUFFER_RECORDS],
+ * so once the buffer wraps the oldest record is overwritten.
+ */
+typedef struct
+{
+  uint32_t magic;
+  uint32_t capacity;
+  volatile uint32_t writeIndex;
+  TraceRecord records[TRACE_BUFFER_RECORDS];
+} TraceBuffer;
+
+#if USE_TRACE
+/**
+ * @brief The trace ring buffer.
+ */
+extern TraceBuffer traceBuffer;
+
+/**
+ * @brief This function will write one record into the trace ring buffer.
+ * 
+ * @param event The event to record
+ * @param task The TCB of the task the event refers to
+ * 
+ * @note The kernel only calls this from SysTick_Handler or with SysTick and PendSV masked, so there is only ever one writer and no lock is needed.
+ * @warning This function should not be called by user code.
+ */
+void traceRecordEvent (TRACE_EVENT event, TCB *task);
+
+#define TRACE_RECORD(event, task) traceRecordEvent ((event), (task))
+#else
+#define TRACE_RECORD(event, task)
+#endif
+
+#endif
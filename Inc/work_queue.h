@@ -0,0 +1,43 @@
+/**
+ * @file    work_queue.h
+ * @brief   Deferred interrupt work queue for SRTOS.
+ * @details
+ * Lets interrupt handlers push work out of interrupt context. An ISR posts a
+ * function pointer and argument, and a kernel worker task runs the function
+ * at `WORK_QUEUE_TASK_PRIORITY`. Enabled with `USE_WORK_QUEUE` in `kernel_config.h`.
+ */
+
+#ifndef WORK_QUEUE_H_
+#define WORK_QUEUE_H_
+
+#include "kernel_config.h"
+#include "task.h"
+#include <stdint.h>
+
+/**
+ * @brief This struct is one posted work item.
+ * 
+ * @note sequence is used by the lock-free queue to know whether a slot is free or holds a posted item.
+ */
+typedef struct
+{
+  volatile uint32_t sequence;
+  void (*workFunc) (void *);
+  void *arg;
+} WorkItem;
+
+#if USE_WORK_QUEUE
+/**
+ * @brief Post a function to be run by the work queue's worker task.
+ * @details The queue is lock-free, so this can be called from interrupts of any priority, including ones that preempt each other.
+ * The worker task is woken if it is blocked, and preempts the interrupted task if it has a higher priority.
+ * 
+ * @param workFunc The function to run in the worker task
+ * @param arg The argument passed to workFunc
+ * 
+ * @return Returns STATUS_SUCCESS if the work was posted, and STATUS_FAILURE if workFunc is NULL or the queue is full.
+ */
+STATUS workQueuePostFromISR (void (*workFunc) (void *), void *arg);
+#endif
+
+#endif
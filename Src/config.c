@@ -9,6 +9,13 @@
 
 #include "config.h"
 
+#if USE_RAM_EXECUTION
+extern uint32_t g_pfnVectors[];
+
+static uint32_t prvRamVectorTable[VECTOR_TABLE_WORDS]
+    __attribute__ ((aligned (VECTOR_TABLE_ALIGNMENT)));
+#endif
+
 /**
  * @brief Configures system clock to use HSE at 8 MhZ
  * 
@@ -37,12 +44,9 @@ configureClock ()
 static void
 configureBlueLED ()
 {
-  /* Enable the RCC Peripheral Clock for GPIOD */
-  RCC_AHB1ENR |= (1 << 3);
+  GPIO_ENABLE_CLOCK (D);
   /* Set the PD15 GPIO Pin (Blue LED) to Output */
-  GPIOD_MODER &= ~(1U << 31);
-  GPIOD_MODER &= ~(1U << 30);
-  GPIOD_MODER |= (1 << 30);
+  GPIO_SET_MODE (D, 15, GPIO_MODE_OUTPUT);
 }
 
 /**
@@ -55,9 +59,7 @@ configureGreenLED ()
 {
   /* Clock already enabled, since blue LED is also on GPIOD */
   /* Green LED: PD12 */
-  GPIOD_MODER &= ~(1U << 24);
-  GPIOD_MODER &= ~(1U << 25);
-  GPIOD_MODER |= (1 << 24);
+  GPIO_SET_MODE (D, 12, GPIO_MODE_OUTPUT);
 }
 
 /**
@@ -69,9 +71,7 @@ static void
 configureOrangeLED ()
 {
   /* Orange LED: PD13 */
-  GPIOD_MODER &= ~(1U << 26);
-  GPIOD_MODER &= ~(1U << 27);
-  GPIOD_MODER |= (1 << 26);
+  GPIO_SET_MODE (D, 13, GPIO_MODE_OUTPUT);
 }
 
 /**
@@ -107,9 +107,35 @@ configureInterruptPriorities ()
   SHPR3 |= (0xE0U << SYSTICK_PRIORITY_START_BIT);
 }
 
+#if USE_RAM_EXECUTION
+/**
+ * @brief Copy the vector table to SRAM and point VTOR at the copy.
+ * 
+ * @note Exception entry fetches the handler address from the vector table in parallel with stacking.
+ * Reading it from SRAM avoids the flash wait states on every interrupt.
+ * @warning This function should not be called by user code.
+ */
+static void
+configureVectorTable ()
+{
+  for (uint32_t i = 0; i < VECTOR_TABLE_WORDS; ++i)
+    {
+      prvRamVectorTable[i] = g_pfnVectors[i];
+    }
+
+  __asm volatile ("DSB\n");
+  SCB_VTOR = (uint32_t)prvRamVectorTable;
+  __asm volatile ("DSB\n"
+                  "ISB\n");
+}
+#endif
+
 void
 configureAll ()
 {
+#if USE_RAM_EXECUTION
+  configureVectorTable ();
+#endif
   configureClock ();
   configureSystickInterrupts ();
   configureBlueLED ();
@@ -0,0 +1,151 @@
+/**
+ * @file    critical_profile.c
+ * @brief   Critical section duration profiler for SRTOS.
+ * @details
+ * Implements the histogram and worst call site table updated by the critical
+ * section functions when `USE_CRITICAL_PROFILE` is enabled.
+ */
+
+#include "critical_profile.h"
+#include "system_funcs.h"
+
+#if USE_CRITICAL_PROFILE
+
+_Static_assert (CRITICAL_PROFILE_HISTOGRAM_BINS > 0U
+                    && CRITICAL_PROFILE_HISTOGRAM_BINS <= 32U,
+                "CRITICAL_PROFILE_HISTOGRAM_BINS must be between 1 and 32");
+_Static_assert (CRITICAL_PROFILE_TOP_SITES > 0U,
+                "CRITICAL_PROFILE_TOP_SITES must be at least 1");
+
+CriticalProfile criticalProfile;
+
+static uint32_t prvEntryCycles;
+static uint32_t prvEntrySite;
+
+/**
+ * @brief This function will start the DWT cycle counter and mark the profile as valid.
+ * 
+ * @warning This function should not be called by user code.
+ */
+static void
+prvCriticalProfileInit ()
+{
+  DEMCR |= (1U << DEMCR_TRCENA_BIT);
+  DWT_CTRL |= (1U << DWT_CTRL_CYCCNTENA_BIT);
+
+  criticalProfile.topSites = CRITICAL_PROFILE_TOP_SITES;
+  criticalProfile.histogramBins = CRITICAL_PROFILE_HISTOGRAM_BINS;
+  criticalProfile.magic = CRITICAL_PROFILE_MAGIC;
+}
+
+/**
+ * @brief This function will update the worst call site table with one measured section.
+ * 
+ * @param callSite The address the section was entered from
+ * @param cycles The duration of the section
+ * 
+ * @warning This function should not be called by user code.
+ */
+static void
+prvRecordSite (uint32_t callSite, uint32_t cycles)
+{
+  CriticalSiteRecord *shortest = &criticalProfile.worstSites[0];
+
+  for (uint32_t i = 0; i < CRITICAL_PROFILE_TOP_SITES; ++i)
+    {
+      CriticalSiteRecord *site = &criticalProfile.worstSites[i];
+      if (site->callSite == callSite)
+        {
+          site->count++;
+          if (cycles > site->worstCycles)
+            {
+              site->worstCycles = cycles;
+            }
+          return;
+        }
+
+      if (site->callSite == 0U
+          || (shortest->callSite != 0U
+              && site->worstCycles < shortest->worstCycles))
+        {
+          shortest = site;
+        }
+    }
+
+  if (shortest->callSite == 0U || cycles > shortest->worstCycles)
+    {
+      shortest->callSite = callSite;
+      shortest->worstCycles = cycles;
+      shortest->count = 1U;
+    }
+}
+
+void
+criticalProfileEnter (uint32_t callSite)
+{
+  prvEntrySite = callSite & ~1U;
+  prvEntryCycles = DWT_CYCCNT;
+}
+
+void
+criticalProfileExit ()
+{
+  uint32_t cycles = DWT_CYCCNT - prvEntryCycles;
+
+  if (prvEntrySite == 0U)
+    {
+      return;
+    }
+
+  if (criticalProfile.magic != CRITICAL_PROFILE_MAGIC)
+    {
+      /* CYCCNT was not running yet, this sample is meaningless */
+      prvCriticalProfileInit ();
+      prvEntrySite = 0U;
+      return;
+    }
+
+  uint32_t bin = 31U - (uint32_t)__builtin_clz (cycles | 1U);
+  if (bin >= CRITICAL_PROFILE_HISTOGRAM_BINS)
+    {
+      bin = CRITICAL_PROFILE_HISTOGRAM_BINS - 1U;
+    }
+
+  criticalProfile.histogram[bin]++;
+  criticalProfile.sections++;
+  prvRecordSite (prvEntrySite, cycles);
+  prvEntrySite = 0U;
+}
+
+void
+criticalProfileSnapshot (CriticalProfile *copy)
+{
+  /* PRIMASK sections are not profiled, so this does not record itself */
+  uint32_t savedPRIMASK = systemENTER_CRITICAL_FROM_ISR ();
+  {
+    *copy = criticalProfile;
+  }
+  systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+}
+
+void
+criticalProfileReset ()
+{
+  uint32_t savedPRIMASK = systemENTER_CRITICAL_FROM_ISR ();
+  {
+    criticalProfile.sections = 0U;
+    for (uint32_t i = 0; i < CRITICAL_PROFILE_HISTOGRAM_BINS; ++i)
+      {
+        criticalProfile.histogram[i] = 0U;
+      }
+    for (uint32_t i = 0; i < CRITICAL_PROFILE_TOP_SITES; ++i)
+      {
+        criticalProfile.worstSites[i].callSite = 0U;
+        criticalProfile.worstSites[i].worstCycles = 0U;
+        criticalProfile.worstSites[i].count = 0U;
+      }
+  }
+  systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+}
+
+#endif
@@ -0,0 +1,230 @@
+/**
+ * @file    event_group.c
+ * @brief   Event groups for SRTOS.
+ * @details
+ * Implements event groups. Each waiting task queues an EventWaiter on its own
+ * stack, so an event group needs no storage per waiter. Bits and waiters are
+ * only changed inside systemENTER_CRITICAL_FROM_ISR () sections, so bits can
+ * be set from interrupts of any priority.
+ */
+
+#include "event_group.h"
+#include "high_res_timer.h"
+
+static uint32_t prvWaitSatisfied (uint32_t bits, uint32_t bitsToWaitFor,
+                                  uint32_t options);
+static void prvInsertWaiter (EventGroup *eventGroup, EventWaiter *waiter);
+static void prvRemoveWaiter (EventGroup *eventGroup, EventWaiter *waiter);
+
+STATUS
+createEventGroup (EventGroup *userAllocatedEventGroup)
+{
+  if (!userAllocatedEventGroup)
+    return STATUS_FAILURE;
+
+  userAllocatedEventGroup->bits = 0;
+  userAllocatedEventGroup->waiters = NULL;
+
+  return STATUS_SUCCESS;
+}
+
+uint32_t
+eventGroupSetBits (EventGroup *eventGroup, uint32_t bitsToSet)
+{
+  uint32_t bits;
+
+  uint32_t savedPRIMASK = systemENTER_CRITICAL_FROM_ISR ();
+  {
+    eventGroup->bits |= bitsToSet;
+    bits = eventGroup->bits;
+
+    uint32_t bitsToClear = 0;
+    EventWaiter **link = &eventGroup->waiters;
+
+    while (*link != NULL)
+      {
+        EventWaiter *waiter = *link;
+        if (!prvWaitSatisfied (bits, waiter->bitsToWaitFor, waiter->options))
+          {
+            link = &waiter->next;
+            continue;
+          }
+
+        if (waiter->options & EVENT_CLEAR_ON_EXIT)
+          {
+            bitsToClear |= waiter->bitsToWaitFor;
+          }
+
+        *link = waiter->next;
+        waiter->resultBits = bits;
+        waiter->queued = 0;
+        systemWakeTaskFromISR (waiter->task);
+      }
+
+    eventGroup->bits &= ~bitsToClear;
+    bits = eventGroup->bits;
+  }
+  systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+
+  return bits;
+}
+
+uint32_t
+eventGroupClearBits (EventGroup *eventGroup, uint32_t bitsToClear)
+{
+  uint32_t bits;
+
+  uint32_t savedPRIMASK = systemENTER_CRITICAL_FROM_ISR ();
+  {
+    bits = eventGroup->bits;
+    eventGroup->bits &= ~bitsToClear;
+  }
+  systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+
+  return bits;
+}
+
+uint32_t
+eventGroupGetBits (EventGroup *eventGroup)
+{
+  return eventGroup->bits;
+}
+
+/**
+ * @brief This function will wait until a wait for bitsToWaitFor is satisfied or the deadline passes.
+ * 
+ * @param timeToWait The ticksToWait or usToWait argument, only checked for 0 so the call does not block
+ * 
+ * @warning This function should not be called by user code.
+ */
+static uint32_t
+prvWaitBits (EventGroup *eventGroup, uint32_t bitsToWaitFor, uint32_t options,
+             uint32_t timeToWait, const WaitDeadline *deadline)
+{
+  uint32_t bits;
+  EventWaiter waiter;
+
+  uint32_t savedPRIMASK = systemENTER_CRITICAL_FROM_ISR ();
+  {
+    bits = eventGroup->bits;
+    if (prvWaitSatisfied (bits, bitsToWaitFor, options))
+      {
+        if (options & EVENT_CLEAR_ON_EXIT)
+          {
+            eventGroup->bits &= ~bitsToWaitFor;
+          }
+        systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+        return bits;
+      }
+
+    if (timeToWait == 0 || bitsToWaitFor == 0)
+      {
+        systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+        return bits;
+      }
+
+    waiter.bitsToWaitFor = bitsToWaitFor;
+    waiter.options = options;
+    waiter.task = curTask;
+    prvInsertWaiter (eventGroup, &waiter);
+  }
+  systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+
+  while (waiter.queued)
+    {
+      if (systemDeadlineReached (deadline))
+        {
+          savedPRIMASK = systemENTER_CRITICAL_FROM_ISR ();
+          {
+            if (waiter.queued)
+              {
+                prvRemoveWaiter (eventGroup, &waiter);
+                waiter.resultBits = eventGroup->bits;
+              }
+          }
+          systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+          break;
+        }
+
+      systemBlockCurTaskUntilDeadline (deadline);
+    }
+
+  return waiter.resultBits;
+}
+
+uint32_t
+eventGroupWaitBits (EventGroup *eventGroup, uint32_t bitsToWaitFor,
+                    uint32_t options, uint32_t ticksToWait)
+{
+  WaitDeadline deadline = systemDeadlineFromTicks (ticksToWait);
+  return prvWaitBits (eventGroup, bitsToWaitFor, options, ticksToWait,
+                      &deadline);
+}
+
+#if USE_HIGH_RES_TIMER
+uint32_t
+eventGroupWaitBitsUs (EventGroup *eventGroup, uint32_t bitsToWaitFor,
+                      uint32_t options, uint32_t usToWait)
+{
+  WaitDeadline deadline = systemDeadlineFromUs (usToWait);
+  return prvWaitBits (eventGroup, bitsToWaitFor, options, usToWait,
+                      &deadline);
+}
+#endif
+
+/**
+ * @brief This function will return non-zero if bits satisfy a wait for bitsToWaitFor.
+ * 
+ * @warning This function should not be called by user code.
+ */
+static uint32_t
+prvWaitSatisfied (uint32_t bits, uint32_t bitsToWaitFor, uint32_t options)
+{
+  if (options & EVENT_WAIT_ALL)
+    {
+      return (bits & bitsToWaitFor) == bitsToWaitFor;
+    }
+
+  return (bits & bitsToWaitFor) != 0;
+}
+
+/**
+ * @brief This function will insert a waiter behind every waiter of equal or higher priority.
+ * 
+ * @warning This function must be called inside a systemENTER_CRITICAL_FROM_ISR () section.
+ */
+static void
+prvInsertWaiter (EventGroup *eventGroup, EventWaiter *waiter)
+{
+  uint32_t priority = systemTASK_BASE_PRIORITY (waiter->task->taskTCB);
+  EventWaiter **link = &eventGroup->waiters;
+
+  while (*link != NULL
+         && systemTASK_BASE_PRIORITY ((*link)->task->taskTCB) >= priority)
+    {
+      link = &(*link)->next;
+    }
+
+  waiter->next = *link;
+  waiter->queued = 1;
+  *link = waiter;
+}
+
+/**
+ * @brief This function will remove a waiter that timed out.
+ * 
+ * @warning This function must be called inside a systemENTER_CRITICAL_FROM_ISR () section.
+ */
+static void
+prvRemoveWaiter (EventGroup *eventGroup, EventWaiter *waiter)
+{
+  EventWaiter **link = &eventGroup->waiters;
+
+  while (*link != waiter)
+    {
+      link = &(*link)->next;
+    }
+
+  *link = waiter->next;
+  waiter->queued = 0;
+}
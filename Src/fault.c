@@ -4,9 +4,11 @@
  * @details
  * Implements handlers for system faults, capturing
  * the fault stack pointer and calling `systemHandle_Fault()`.
+ * Faults are appended to a ring of `FaultRecord`s in the FAULT_DATA flash sector.
  */
 
 #include "fault.h"
+#include "task.h"
 
 __attribute ((naked)) uint32_t *
 systemGet_Fault_SP (__attribute__ ((unused)) uint32_t faultLR)
@@ -18,8 +20,13 @@ systemGet_Fault_SP (__attribute__ ((unused)) uint32_t faultLR)
                   "BX lr\n");
 }
 
-void
-systemHandle_Fault (uint32_t *faultSP)
+/**
+ * @brief Unlock the flash control register and select 32 bit programming parallelism.
+ * 
+ * @warning This function should not be called by user code.
+ */
+static void
+prvFlashUnlock ()
 {
   FLASH_KEYR = FLASH_UNLOCK_KEY1;
   FLASH_KEYR = FLASH_UNLOCK_KEY2;
@@ -34,6 +41,18 @@ systemHandle_Fault (uint32_t *faultSP)
 
   while (FLASH_SR & (1U << FLASH_SR_BSY_BIT))
     ;
+}
+
+/**
+ * @brief Erase flash sector 7 (FAULT_DATA).
+ * 
+ * @note This takes over a second, so it is only done once the fault log is full.
+ * @warning This function should not be called by user code.
+ */
+static void
+prvFlashEraseFaultSector ()
+{
+  FLASH_CR &= ~(1U << FLASH_CR_PG_BIT);
 
   /* Activate Sector Erase */
   FLASH_CR |= (1U << FLASH_CR_SER_BIT);
@@ -47,10 +66,68 @@ systemHandle_Fault (uint32_t *faultSP)
   while (FLASH_SR & (1U << FLASH_SR_BSY_BIT))
     ;
 
-  FLASH_CR |= (1U << FLASH_CR_PG_BIT);
+  FLASH_CR &= ~(1U << FLASH_CR_SER_BIT);
+}
+
+/**
+ * @brief Return non-zero if every word of a record slot is erased.
+ * 
+ * @warning This function should not be called by user code.
+ */
+static uint32_t
+prvFaultRecordErased (volatile FaultRecord *slot)
+{
+  volatile uint32_t *words = (volatile uint32_t *)slot;
+
+  for (uint32_t i = 0; i < sizeof (FaultRecord) / sizeof (uint32_t); i++)
+    {
+      if (words[i] != FLASH_ERASED_WORD)
+        {
+          return 0;
+        }
+    }
+
+  return 1;
+}
+
+/**
+ * @brief Find the first erased record slot in the fault log.
+ * 
+ * @param nextSequence Set to one more than the sequence of the last complete record, or 0 if there is none.
+ * 
+ * @return Returns the address of the first erased slot, or NULL if the fault log is full.
+ * 
+ * @note Torn records, whose magic was never programmed, are skipped rather than written over.
+ * @warning This function should not be called by user code.
+ */
+static volatile FaultRecord *
+prvFindFreeFaultRecord (uint32_t *nextSequence)
+{
+  volatile FaultRecord *faultLog
+      = (volatile FaultRecord *)FAULT_DATA_FLASH_START_ADDR;
+
+  *nextSequence = 0;
+
+  for (uint32_t i = 0; i < FAULT_RECORD_SLOTS; ++i)
+    {
+      if (faultLog[i].magic == FAULT_RECORD_MAGIC)
+        {
+          *nextSequence = faultLog[i].sequence + 1U;
+        }
+      else if (prvFaultRecordErased (&faultLog[i]))
+        {
+          return &faultLog[i];
+        }
+    }
 
+  return NULL;
+}
+
+void
+systemHandle_Fault (uint32_t *faultSP, uint32_t *calleeSavedRegs)
+{
   /*
-   * Push order:
+   * Stacked frame order:
    * r0
    * r1
    * r2
@@ -60,17 +137,54 @@ systemHandle_Fault (uint32_t *faultSP)
    * pc
    * psr
    * */
-
-  volatile uint32_t *curWriteAddr
-      = (volatile uint32_t *)FAULT_DATA_FLASH_START_ADDR;
+  FaultRecord record;
+  record.magic = FAULT_RECORD_MAGIC;
+  for (int i = 0; i < 4; i++)
+    {
+      record.r[i] = faultSP[i];
+    }
   for (int i = 0; i < 8; i++)
     {
-      *(curWriteAddr) = faultSP[i];
-      curWriteAddr += 1;
+      record.r[i + 4] = calleeSavedRegs[i];
+    }
+  record.r[12] = faultSP[4];
+  record.sp = (uint32_t)faultSP;
+  record.lr = faultSP[5];
+  record.pc = faultSP[6];
+  record.xpsr = faultSP[7];
+  record.cfsr = SCB_CFSR;
+  record.hfsr = SCB_HFSR;
+  record.mmfar = SCB_MMFAR;
+  record.bfar = SCB_BFAR;
+  record.msTicksLow = (uint32_t)msTicks;
+  record.msTicksHigh = (uint32_t)(msTicks >> 32);
+  record.taskID = (curTask != NULL) ? curTask->taskTCB->id : FAULT_NO_TASK_ID;
+
+  prvFlashUnlock ();
+
+  volatile FaultRecord *slot = prvFindFreeFaultRecord (&record.sequence);
+  if (slot == NULL)
+    {
+      prvFlashEraseFaultSector ();
+      slot = (volatile FaultRecord *)FAULT_DATA_FLASH_START_ADDR;
     }
 
-  while (FLASH_SR & (1U << FLASH_SR_BSY_BIT))
-    ;
+  FLASH_CR |= (1U << FLASH_CR_PG_BIT);
+
+  /* Program the magic word last, so a record torn by a reset is not valid */
+  volatile uint32_t *writeAddr = (volatile uint32_t *)slot;
+  uint32_t *readAddr = (uint32_t *)&record;
+  uint32_t words = sizeof (FaultRecord) / sizeof (uint32_t);
+  for (uint32_t i = 1; i <= words; i++)
+    {
+      uint32_t word = i % words;
+      writeAddr[word] = readAddr[word];
+
+      while (FLASH_SR & (1U << FLASH_SR_BSY_BIT))
+        ;
+    }
+
+  FLASH_CR &= ~(1U << FLASH_CR_PG_BIT);
 
   while (1)
     ;
@@ -81,6 +195,8 @@ HardFault_Handler ()
 {
   __asm volatile ("MOV r0, lr\n"
                   "BL systemGet_Fault_SP\n"
-                  "LDR r1, =systemHandle_Fault\n"
-                  "BX r1\n");
+                  "PUSH {r4-r11}\n"
+                  "MOV r1, sp\n"
+                  "LDR r2, =systemHandle_Fault\n"
+                  "BX r2\n");
 }
@@ -0,0 +1,294 @@
+/**
+ * @file    high_res_timer.c
+ * @brief   Microsecond delays for SRTOS.
+ * @details
+ * Implements the TIM5 based microsecond time base and the sorted list of tasks
+ * waiting on it. Only the earliest wake time is programmed into the compare
+ * register, so the interrupt fires once per wake time instead of every tick.
+ * Blocking calls with a microsecond timeout queue a waiter on the same list
+ * and remove it again if they are woken first.
+ */
+
+#include "high_res_timer.h"
+
+#if USE_HIGH_RES_TIMER
+static void prvBlockCurTaskUntilWokenUs (uint32_t wakeTimeUs);
+#endif
+
+WaitDeadline
+systemDeadlineFromTicks (uint32_t ticksToWait)
+{
+  WaitDeadline deadline = { .ticks = DELAYED_FOREVER, .us = 0, .inUs = 0 };
+
+  if (ticksToWait != 0xFFFFFFFFU)
+    {
+      deadline.ticks = getTickCount () + ticksToWait;
+    }
+
+  return deadline;
+}
+
+uint32_t
+systemDeadlineReached (const WaitDeadline *deadline)
+{
+#if USE_HIGH_RES_TIMER
+  if (deadline->inUs)
+    {
+      return (int32_t)(TIM5_CNT - deadline->us) >= 0;
+    }
+#endif
+
+  return getTickCount () >= deadline->ticks;
+}
+
+void
+systemBlockCurTaskUntilDeadline (const WaitDeadline *deadline)
+{
+#if USE_HIGH_RES_TIMER
+  if (deadline->inUs)
+    {
+      prvBlockCurTaskUntilWokenUs (deadline->us);
+      return;
+    }
+#endif
+
+  systemBlockCurTaskUntilWoken (deadline->ticks);
+}
+
+#if USE_HIGH_RES_TIMER
+
+_Static_assert (HIGH_RES_TIMER_CLOCK_HZ % 1000000U == 0,
+                "HIGH_RES_TIMER_CLOCK_HZ must be a multiple of 1 MHz");
+
+static HighResWaiter *prvWaiters;
+
+static void prvInsertWaiter (HighResWaiter *waiter);
+static void prvRemoveWaiter (HighResWaiter *waiter);
+static void prvProgramCompare ();
+static void prvBlockOnWaiter (HighResWaiter *waiter);
+
+/**
+ * @brief This function will return non-zero if time a is at or after time b.
+ * 
+ * @warning This function should not be called by user code.
+ */
+static inline uint32_t
+prvTimeReached (uint32_t a, uint32_t b)
+{
+  return (int32_t)(a - b) >= 0;
+}
+
+WaitDeadline
+systemDeadlineFromUs (uint32_t usToWait)
+{
+  WaitDeadline deadline = { .ticks = DELAYED_FOREVER, .us = 0, .inUs = 0 };
+
+  if (usToWait != 0xFFFFFFFFU)
+    {
+      deadline.us = TIM5_CNT + usToWait;
+      deadline.inUs = 1;
+    }
+
+  return deadline;
+}
+
+uint32_t
+getTimeUs ()
+{
+  return TIM5_CNT;
+}
+
+void
+taskDelayUs (uint32_t usToDelay)
+{
+  if (usToDelay == 0)
+    {
+      return;
+    }
+
+  HighResWaiter waiter;
+  waiter.wakeTimeUs = TIM5_CNT + usToDelay;
+  prvBlockOnWaiter (&waiter);
+}
+
+void
+taskDelayUntilUs (uint32_t *lastWakeTimeUs, uint32_t periodUs)
+{
+  HighResWaiter waiter;
+  waiter.wakeTimeUs = *lastWakeTimeUs + periodUs;
+  *lastWakeTimeUs = waiter.wakeTimeUs;
+
+  if (prvTimeReached (TIM5_CNT, waiter.wakeTimeUs))
+    {
+      return;
+    }
+
+  prvBlockOnWaiter (&waiter);
+}
+
+void
+systemHighResTimerInit ()
+{
+  RCC_APB1ENR |= (1U << RCC_APB1ENR_TIM5EN_BIT);
+
+  TIM5_PSC = HIGH_RES_TIMER_CLOCK_HZ / 1000000U - 1U;
+  TIM5_ARR = 0xFFFFFFFFU;
+  TIM5_CNT = 0;
+  /* Load the prescaler now, then discard the update event it caused */
+  TIM5_EGR = (1U << TIM_EGR_UG_BIT);
+  TIM5_SR = 0;
+  TIM5_CR1 |= (1U << TIM_CR1_CEN_BIT);
+
+  /* Highest priority, the handler only touches the waiter list */
+  NVIC_IPR (TIM5_IRQ_NUMBER) = 0x00;
+  NVIC_ISER (TIM5_IRQ_NUMBER) = (1U << (TIM5_IRQ_NUMBER % 32U));
+}
+
+void
+TIM5_IRQHandler ()
+{
+  TIM5_SR = ~(1U << TIM_SR_CC1IF_BIT);
+
+  uint32_t savedPRIMASK = systemENTER_CRITICAL_FROM_ISR ();
+  {
+    while (prvWaiters != NULL
+           && prvTimeReached (TIM5_CNT, prvWaiters->wakeTimeUs))
+      {
+        HighResWaiter *waiter = prvWaiters;
+        prvWaiters = waiter->next;
+        waiter->queued = 0;
+        systemWakeTaskFromISRAndPreempt (waiter->task);
+      }
+
+    prvProgramCompare ();
+  }
+  systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+}
+
+/**
+ * @brief This function will queue the current task on the timer and block it until TIM5_IRQHandler () dequeues it.
+ * 
+ * @param waiter The waiter on the current task's stack, with wakeTimeUs set
+ * 
+ * @note The waiter must not be reused before it is dequeued, so a wake for another reason, such as a stale
+ * systemWakeTaskFromISR (), just blocks the task again.
+ * @warning This function should not be called by user code.
+ */
+static void
+prvBlockOnWaiter (HighResWaiter *waiter)
+{
+  waiter->task = curTask;
+
+  uint32_t savedPRIMASK = systemENTER_CRITICAL_FROM_ISR ();
+  {
+    prvInsertWaiter (waiter);
+    prvProgramCompare ();
+  }
+  systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+
+  while (waiter->queued)
+    {
+      systemBlockCurTaskUntilWoken (DELAYED_FOREVER);
+    }
+}
+
+/**
+ * @brief This function will block the current task until it is woken or wakeTimeUs passes, whichever is first.
+ * 
+ * @note The task may also return early for a stale systemWakeTaskFromISR (), so the caller must check its condition again.
+ * @warning This function should not be called by user code.
+ */
+static void
+prvBlockCurTaskUntilWokenUs (uint32_t wakeTimeUs)
+{
+  HighResWaiter waiter;
+  waiter.wakeTimeUs = wakeTimeUs;
+  waiter.task = curTask;
+
+  uint32_t savedPRIMASK = systemENTER_CRITICAL_FROM_ISR ();
+  {
+    prvInsertWaiter (&waiter);
+    prvProgramCompare ();
+  }
+  systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+
+  systemBlockCurTaskUntilWoken (DELAYED_FOREVER);
+
+  savedPRIMASK = systemENTER_CRITICAL_FROM_ISR ();
+  {
+    if (waiter.queued)
+      {
+        prvRemoveWaiter (&waiter);
+        prvProgramCompare ();
+      }
+  }
+  systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+}
+
+/**
+ * @brief This function will insert a waiter into the list, keeping it sorted by wake time.
+ * 
+ * @note Waiters with equal wake times stay in the order they were inserted.
+ * @warning This function must be called with interrupts disabled.
+ */
+static void
+prvInsertWaiter (HighResWaiter *waiter)
+{
+  HighResWaiter **link = &prvWaiters;
+
+  while (*link != NULL
+         && prvTimeReached (waiter->wakeTimeUs, (*link)->wakeTimeUs))
+    {
+      link = &(*link)->next;
+    }
+
+  waiter->next = *link;
+  waiter->queued = 1;
+  *link = waiter;
+}
+
+/**
+ * @brief This function will remove a waiter that was woken for another reason before its wake time.
+ * 
+ * @warning This function must be called with interrupts disabled.
+ */
+static void
+prvRemoveWaiter (HighResWaiter *waiter)
+{
+  HighResWaiter **link = &prvWaiters;
+
+  while (*link != waiter)
+    {
+      link = &(*link)->next;
+    }
+
+  *link = waiter->next;
+  waiter->queued = 0;
+}
+
+/**
+ * @brief This function will set the compare register to the earliest wake time, or disable the interrupt if no task waits.
+ * 
+ * @note A compare match only happens when the counter reaches the compare value, so if the earliest wake time
+ * passed before it was programmed, the interrupt is pended by hand.
+ * @warning This function must be called with interrupts disabled.
+ */
+static void
+prvProgramCompare ()
+{
+  if (prvWaiters == NULL)
+    {
+      TIM5_DIER &= ~(1U << TIM_DIER_CC1IE_BIT);
+      return;
+    }
+
+  TIM5_CCR1 = prvWaiters->wakeTimeUs;
+  TIM5_DIER |= (1U << TIM_DIER_CC1IE_BIT);
+
+  if (prvTimeReached (TIM5_CNT, prvWaiters->wakeTimeUs))
+    {
+      NVIC_ISPR (TIM5_IRQ_NUMBER) = (1U << (TIM5_IRQ_NUMBER % 32U));
+    }
+}
+
+#endif
@@ -0,0 +1,152 @@
+/**
+ * @file    job.c
+ * @brief   Run-to-completion jobs for SRTOS.
+ * @details
+ * Implements the per-priority job dispatchers. Each dispatcher is a normal
+ * task that owns the shared stack of its priority level and runs every
+ * released job to completion before it blocks.
+ */
+
+#include "job.h"
+#include "atomic.h"
+
+#if USE_JOBS
+
+typedef struct
+{
+  uint32_t stack[STACK_SIZE];
+  TCB tcb;
+  TaskNode node;
+  Job *jobs;
+} JobDispatcher;
+
+static JobDispatcher prvDispatchers[JOB_PRIORITY_LEVELS];
+static uint32_t prvDispatchersUsed = 0;
+
+static void prvJobDispatcherTask ();
+
+/**
+ * @brief This function will find the dispatcher of a priority level, creating it if it does not exist yet.
+ * 
+ * @param priority The priority level
+ * 
+ * @return Returns the dispatcher, or NULL if every dispatcher is already used by another priority level.
+ * 
+ * @warning This function should not be called by user code.
+ */
+static JobDispatcher *
+prvGetDispatcher (uint32_t priority)
+{
+  for (uint32_t i = 0; i < prvDispatchersUsed; ++i)
+    {
+      if (prvDispatchers[i].tcb.priority == priority)
+        {
+          return &prvDispatchers[i];
+        }
+    }
+
+  if (prvDispatchersUsed == JOB_PRIORITY_LEVELS)
+    {
+      return NULL;
+    }
+
+  JobDispatcher *dispatcher = &prvDispatchers[prvDispatchersUsed];
+  if (createTask (dispatcher->stack, &prvJobDispatcherTask, priority,
+                  &dispatcher->tcb, &dispatcher->node)
+      != STATUS_SUCCESS)
+    {
+      return NULL;
+    }
+  prvDispatchersUsed++;
+
+  return dispatcher;
+}
+
+STATUS
+createJob (Job *userAllocatedJob, void (*jobFunc) (void),
+           unsigned int priority, uint32_t period)
+{
+  if (!userAllocatedJob || !jobFunc)
+    return STATUS_FAILURE;
+  if (priority >= MAX_PRIORITIES)
+    return STATUS_FAILURE;
+
+  JobDispatcher *dispatcher = prvGetDispatcher (priority);
+  if (dispatcher == NULL)
+    return STATUS_FAILURE;
+
+  userAllocatedJob->jobFunc = jobFunc;
+  userAllocatedJob->period = period;
+  userAllocatedJob->nextRelease = period;
+  userAllocatedJob->pending = 0;
+  userAllocatedJob->dispatcher = &dispatcher->node;
+  userAllocatedJob->next = NULL;
+
+  /* Insert at end of the dispatcher's jobs linked list */
+  Job **tail = &dispatcher->jobs;
+  while (*tail != NULL)
+    {
+      tail = &(*tail)->next;
+    }
+  *tail = userAllocatedJob;
+
+  return STATUS_SUCCESS;
+}
+
+void
+triggerJob (Job *job)
+{
+  atomicStore (&job->pending, 1U);
+  systemWakeTaskFromISR (job->dispatcher);
+}
+
+/**
+ * @brief This function is the dispatcher task of one priority level.
+ * @details On every wake it releases the periodic jobs that are due, runs every pending job to completion in creation order,
+ * and then blocks until the next periodic release or the next triggerJob ().
+ * 
+ * @warning This function should not be called by user code.
+ */
+static void
+prvJobDispatcherTask ()
+{
+  JobDispatcher *dispatcher = NULL;
+  for (uint32_t i = 0; i < prvDispatchersUsed; ++i)
+    {
+      if (&prvDispatchers[i].node == curTask)
+        {
+          dispatcher = &prvDispatchers[i];
+        }
+    }
+
+  for (;;)
+    {
+      uint64_t now = getTickCount ();
+      uint64_t nextWakeTime = DELAYED_FOREVER;
+
+      for (Job *job = dispatcher->jobs; job != NULL; job = job->next)
+        {
+          if (job->period != 0)
+            {
+              if (job->nextRelease <= now)
+                {
+                  job->pending = 1;
+                  job->nextRelease += job->period;
+                }
+              if (job->nextRelease < nextWakeTime)
+                {
+                  nextWakeTime = job->nextRelease;
+                }
+            }
+
+          if (atomicExchange (&job->pending, 0U))
+            {
+              job->jobFunc ();
+            }
+        }
+
+      systemBlockCurTaskUntilWoken (nextWakeTime);
+    }
+}
+
+#endif
@@ -0,0 +1,466 @@
+/**
+ * @file    queue.c
+ * @brief   Message queues, semaphores and queue sets for SRTOS.
+ * @details
+ * Implements semaphores, queues and queue sets. Object state is only changed
+ * inside short systemENTER_CRITICAL_FROM_ISR () sections, and waiting tasks
+ * are woken with systemWakeTaskFromISR (), so the give and send paths are
+ * safe from interrupts of any priority. The blocking calls wait on a
+ * WaitDeadline, so the tick and microsecond variants share one implementation.
+ */
+
+#include "queue.h"
+#include "high_res_timer.h"
+
+/**
+ * @brief This function will insert a waiter behind every waiter of equal or higher priority.
+ * 
+ * @warning This function must be called inside a systemENTER_CRITICAL_FROM_ISR () section.
+ */
+static void
+prvInsertWaiter (ObjectWaiter **waiters, ObjectWaiter *waiter)
+{
+  uint32_t priority = systemTASK_BASE_PRIORITY (waiter->task->taskTCB);
+  ObjectWaiter **link = waiters;
+
+  while (*link != NULL
+         && systemTASK_BASE_PRIORITY ((*link)->task->taskTCB) >= priority)
+    {
+      link = &(*link)->next;
+    }
+
+  waiter->next = *link;
+  waiter->queued = 1;
+  *link = waiter;
+}
+
+/**
+ * @brief This function will remove a waiter if it is still queued.
+ * 
+ * @warning This function must be called inside a systemENTER_CRITICAL_FROM_ISR () section.
+ */
+static void
+prvRemoveWaiter (ObjectWaiter **waiters, ObjectWaiter *waiter)
+{
+  if (!waiter->queued)
+    {
+      return;
+    }
+
+  ObjectWaiter **link = waiters;
+
+  while (*link != waiter)
+    {
+      link = &(*link)->next;
+    }
+
+  *link = waiter->next;
+  waiter->queued = 0;
+}
+
+/**
+ * @brief This function will dequeue and wake the highest priority waiter, if there is one.
+ * 
+ * @warning This function must be called inside a systemENTER_CRITICAL_FROM_ISR () section.
+ */
+static void
+prvWakeFirstWaiter (ObjectWaiter **waiters)
+{
+  ObjectWaiter *waiter = *waiters;
+  if (waiter == NULL)
+    {
+      return;
+    }
+
+  *waiters = waiter->next;
+  waiter->queued = 0;
+  systemWakeTaskFromISR (waiter->task);
+}
+
+/**
+ * @brief This function will record that an object became ready and wake the tasks waiting for it.
+ * @details The highest priority task blocked on the object itself is woken. If the object is in a queue set, the object
+ * is also added to the back of the set's ready FIFO and the highest priority task blocked on the set is woken.
+ * 
+ * @param object The object that became ready
+ * 
+ * @note This function must be called inside a systemENTER_CRITICAL_FROM_ISR () section.
+ * @warning This function should not be called by user code.
+ */
+static void
+prvNotifyObjectReady (KernelObject *object)
+{
+  prvWakeFirstWaiter (&object->waiters);
+
+  QueueSet *set = object->set;
+  if (set == NULL)
+    {
+      return;
+    }
+
+  /* A member never has more entries than items, so the capacity reserved by
+     prvQueueSetAddObject () keeps the FIFO from filling */
+  if (set->count < set->length)
+    {
+      set->readyMembers[(set->head + set->count) % set->length] = object;
+      set->count++;
+      object->setEntries++;
+    }
+
+  prvWakeFirstWaiter (&set->waiters);
+}
+
+/**
+ * @brief This function will remove the newest set entry of an object that has more entries than items left.
+ * @details An item taken directly from a set member, rather than after queueSetSelect () returned it, leaves an entry
+ * behind. Removing it keeps queueSetSelect () from returning the member once it is empty.
+ * 
+ * @param object The object an item was just taken from
+ * @param itemsLeft The number of items the object holds after the take
+ * 
+ * @note This function must be called inside a systemENTER_CRITICAL_FROM_ISR () section.
+ * @warning This function should not be called by user code.
+ */
+static void
+prvDropStaleSetEntry (KernelObject *object, uint32_t itemsLeft)
+{
+  QueueSet *set = object->set;
+  if (set == NULL || object->setEntries <= itemsLeft)
+    {
+      return;
+    }
+
+  for (uint32_t i = set->count; i > 0; i--)
+    {
+      if (set->readyMembers[(set->head + i - 1U) % set->length] != object)
+        {
+          continue;
+        }
+
+      /* Close the gap by moving the newer entries forward */
+      for (uint32_t j = i; j < set->count; j++)
+        {
+          set->readyMembers[(set->head + j - 1U) % set->length]
+              = set->readyMembers[(set->head + j) % set->length];
+        }
+      set->count--;
+      object->setEntries--;
+      return;
+    }
+}
+
+STATUS
+createSemaphore (Semaphore *userAllocatedSemaphore, uint32_t initialCount,
+                 uint32_t maxCount)
+{
+  if (!userAllocatedSemaphore || maxCount == 0 || initialCount > maxCount)
+    return STATUS_FAILURE;
+
+  userAllocatedSemaphore->object.set = NULL;
+  userAllocatedSemaphore->object.waiters = NULL;
+  userAllocatedSemaphore->object.setEntries = 0;
+  userAllocatedSemaphore->count = initialCount;
+  userAllocatedSemaphore->maxCount = maxCount;
+
+  return STATUS_SUCCESS;
+}
+
+STATUS
+semaphoreGive (Semaphore *semaphore)
+{
+  uint32_t savedPRIMASK = systemENTER_CRITICAL_FROM_ISR ();
+  {
+    if (semaphore->count == semaphore->maxCount)
+      {
+        systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+        return STATUS_FAILURE;
+      }
+
+    semaphore->count++;
+    prvNotifyObjectReady (&semaphore->object);
+  }
+  systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+
+  return STATUS_SUCCESS;
+}
+
+/**
+ * @brief This function will take a semaphore, blocking until it is above 0 or the deadline passes.
+ * 
+ * @warning This function should not be called by user code.
+ */
+static STATUS
+prvSemaphoreTake (Semaphore *semaphore, const WaitDeadline *deadline)
+{
+  ObjectWaiter waiter = { .task = curTask, .next = NULL, .queued = 0 };
+
+  for (;;)
+    {
+      uint32_t timedOut = systemDeadlineReached (deadline);
+
+      uint32_t savedPRIMASK = systemENTER_CRITICAL_FROM_ISR ();
+      {
+        if (semaphore->count > 0)
+          {
+            semaphore->count--;
+            prvDropStaleSetEntry (&semaphore->object, semaphore->count);
+            prvRemoveWaiter (&semaphore->object.waiters, &waiter);
+            systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+            return STATUS_SUCCESS;
+          }
+
+        if (timedOut)
+          {
+            prvRemoveWaiter (&semaphore->object.waiters, &waiter);
+            systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+            return STATUS_FAILURE;
+          }
+
+        if (!waiter.queued)
+          {
+            prvInsertWaiter (&semaphore->object.waiters, &waiter);
+          }
+      }
+      systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+
+      systemBlockCurTaskUntilDeadline (deadline);
+    }
+}
+
+STATUS
+semaphoreTake (Semaphore *semaphore, uint32_t ticksToWait)
+{
+  WaitDeadline deadline = systemDeadlineFromTicks (ticksToWait);
+  return prvSemaphoreTake (semaphore, &deadline);
+}
+
+#if USE_HIGH_RES_TIMER
+STATUS
+semaphoreTakeUs (Semaphore *semaphore, uint32_t usToWait)
+{
+  WaitDeadline deadline = systemDeadlineFromUs (usToWait);
+  return prvSemaphoreTake (semaphore, &deadline);
+}
+#endif
+
+STATUS
+createQueue (Queue *userAllocatedQueue, uint32_t buffer[], uint32_t length)
+{
+  if (!userAllocatedQueue || !buffer || length == 0)
+    return STATUS_FAILURE;
+
+  userAllocatedQueue->object.set = NULL;
+  userAllocatedQueue->object.waiters = NULL;
+  userAllocatedQueue->object.setEntries = 0;
+  userAllocatedQueue->buffer = buffer;
+  userAllocatedQueue->length = length;
+  userAllocatedQueue->head = 0;
+  userAllocatedQueue->count = 0;
+
+  return STATUS_SUCCESS;
+}
+
+STATUS
+queueSend (Queue *queue, uint32_t item)
+{
+  uint32_t savedPRIMASK = systemENTER_CRITICAL_FROM_ISR ();
+  {
+    if (queue->count == queue->length)
+      {
+        systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+        return STATUS_FAILURE;
+      }
+
+    queue->buffer[(queue->head + queue->count) % queue->length] = item;
+    queue->count++;
+    prvNotifyObjectReady (&queue->object);
+  }
+  systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+
+  return STATUS_SUCCESS;
+}
+
+/**
+ * @brief This function will receive from a queue, blocking until it holds an item or the deadline passes.
+ * 
+ * @warning This function should not be called by user code.
+ */
+static STATUS
+prvQueueReceive (Queue *queue, uint32_t *item, const WaitDeadline *deadline)
+{
+  ObjectWaiter waiter = { .task = curTask, .next = NULL, .queued = 0 };
+
+  for (;;)
+    {
+      uint32_t timedOut = systemDeadlineReached (deadline);
+
+      uint32_t savedPRIMASK = systemENTER_CRITICAL_FROM_ISR ();
+      {
+        if (queue->count > 0)
+          {
+            *item = queue->buffer[queue->head];
+            queue->head = (queue->head + 1U) % queue->length;
+            queue->count--;
+            prvDropStaleSetEntry (&queue->object, queue->count);
+            prvRemoveWaiter (&queue->object.waiters, &waiter);
+            systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+            return STATUS_SUCCESS;
+          }
+
+        if (timedOut)
+          {
+            prvRemoveWaiter (&queue->object.waiters, &waiter);
+            systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+            return STATUS_FAILURE;
+          }
+
+        if (!waiter.queued)
+          {
+            prvInsertWaiter (&queue->object.waiters, &waiter);
+          }
+      }
+      systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+
+      systemBlockCurTaskUntilDeadline (deadline);
+    }
+}
+
+STATUS
+queueReceive (Queue *queue, uint32_t *item, uint32_t ticksToWait)
+{
+  WaitDeadline deadline = systemDeadlineFromTicks (ticksToWait);
+  return prvQueueReceive (queue, item, &deadline);
+}
+
+#if USE_HIGH_RES_TIMER
+STATUS
+queueReceiveUs (Queue *queue, uint32_t *item, uint32_t usToWait)
+{
+  WaitDeadline deadline = systemDeadlineFromUs (usToWait);
+  return prvQueueReceive (queue, item, &deadline);
+}
+#endif
+
+STATUS
+createQueueSet (QueueSet *userAllocatedQueueSet, void *buffer[],
+                uint32_t length)
+{
+  if (!userAllocatedQueueSet || !buffer || length == 0)
+    return STATUS_FAILURE;
+
+  userAllocatedQueueSet->readyMembers = buffer;
+  userAllocatedQueueSet->length = length;
+  userAllocatedQueueSet->capacityUsed = 0;
+  userAllocatedQueueSet->head = 0;
+  userAllocatedQueueSet->count = 0;
+  userAllocatedQueueSet->waiters = NULL;
+
+  return STATUS_SUCCESS;
+}
+
+/**
+ * @brief This function will add an object to a queue set, reserving capacity entries in the set's buffer for it.
+ * 
+ * @warning This function should not be called by user code.
+ */
+static STATUS
+prvQueueSetAddObject (QueueSet *queueSet, KernelObject *object,
+                      uint32_t capacity)
+{
+  STATUS resStatus = STATUS_FAILURE;
+
+  uint32_t savedPRIMASK = systemENTER_CRITICAL_FROM_ISR ();
+  {
+    if (object->set == NULL
+        && queueSet->capacityUsed + capacity <= queueSet->length)
+      {
+        object->set = queueSet;
+        queueSet->capacityUsed += capacity;
+        resStatus = STATUS_SUCCESS;
+      }
+  }
+  systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+
+  return resStatus;
+}
+
+STATUS
+queueSetAddSemaphore (QueueSet *queueSet, Semaphore *semaphore)
+{
+  if (!queueSet || !semaphore || semaphore->count != 0)
+    return STATUS_FAILURE;
+
+  return prvQueueSetAddObject (queueSet, &semaphore->object,
+                               semaphore->maxCount);
+}
+
+STATUS
+queueSetAddQueue (QueueSet *queueSet, Queue *queue)
+{
+  if (!queueSet || !queue || queue->count != 0)
+    return STATUS_FAILURE;
+
+  return prvQueueSetAddObject (queueSet, &queue->object, queue->length);
+}
+
+/**
+ * @brief This function will select a ready member of a queue set, blocking until there is one or the deadline passes.
+ * 
+ * @warning This function should not be called by user code.
+ */
+static void *
+prvQueueSetSelect (QueueSet *queueSet, const WaitDeadline *deadline)
+{
+  ObjectWaiter waiter = { .task = curTask, .next = NULL, .queued = 0 };
+
+  for (;;)
+    {
+      uint32_t timedOut = systemDeadlineReached (deadline);
+
+      uint32_t savedPRIMASK = systemENTER_CRITICAL_FROM_ISR ();
+      {
+        if (queueSet->count > 0)
+          {
+            KernelObject *readyMember
+                = queueSet->readyMembers[queueSet->head];
+            queueSet->head = (queueSet->head + 1U) % queueSet->length;
+            queueSet->count--;
+            readyMember->setEntries--;
+            prvRemoveWaiter (&queueSet->waiters, &waiter);
+            systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+            return readyMember;
+          }
+
+        if (timedOut)
+          {
+            prvRemoveWaiter (&queueSet->waiters, &waiter);
+            systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+            return NULL;
+          }
+
+        if (!waiter.queued)
+          {
+            prvInsertWaiter (&queueSet->waiters, &waiter);
+          }
+      }
+      systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+
+      systemBlockCurTaskUntilDeadline (deadline);
+    }
+}
+
+void *
+queueSetSelect (QueueSet *queueSet, uint32_t ticksToWait)
+{
+  WaitDeadline deadline = systemDeadlineFromTicks (ticksToWait);
+  return prvQueueSetSelect (queueSet, &deadline);
+}
+
+#if USE_HIGH_RES_TIMER
+void *
+queueSetSelectUs (QueueSet *queueSet, uint32_t usToWait)
+{
+  WaitDeadline deadline = systemDeadlineFromUs (usToWait);
+  return prvQueueSetSelect (queueSet, &deadline);
+}
+#endif
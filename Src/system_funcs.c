@@ -6,13 +6,14 @@
  */
 
 #include "system_funcs.h"
+#include "critical_profile.h"
 
 /**
  * @brief Enter a critical section by disabling all interrupts.
  * 
  * @warning This function should not be called by user code.
  */
-void
+void RAMFUNC
 systemENTER_CRITICAL ()
 {
   /* Mask priorities 0xE0 to 0xFF, which includes
@@ -20,7 +21,11 @@ systemENTER_CRITICAL ()
    */
   __asm volatile ("MOV r0, #0xE0\n"
                   "MSR BASEPRI, r0\n"
-                  "ISB\n");
+                  "ISB\n"
+                  :
+                  :
+                  : "r0");
+  CRITICAL_PROFILE_ENTER (__builtin_return_address (0));
 }
 
 /**
@@ -28,10 +33,51 @@ systemENTER_CRITICAL ()
  * 
  * @warning This function should not be called by user code.
  */
-void
+void RAMFUNC
 systemEXIT_CRITICAL ()
 {
+  CRITICAL_PROFILE_EXIT ();
   __asm volatile ("MOV r0, #0x00\n"
                   "MSR BASEPRI, r0\n"
-                  "ISB\n");
+                  "ISB\n"
+                  :
+                  :
+                  : "r0");
+}
+
+/**
+ * @brief Enter a short critical section by disabling every configurable interrupt.
+ * @details Unlike systemENTER_CRITICAL (), this also masks interrupts above SysTick, so it is safe to use
+ * in data shared with interrupts of any priority. It can be nested and called from interrupts.
+ * 
+ * @return Returns the previous PRIMASK value, which must be passed to systemEXIT_CRITICAL_FROM_ISR ().
+ * 
+ * @warning This function should not be called by user code.
+ */
+uint32_t RAMFUNC
+systemENTER_CRITICAL_FROM_ISR ()
+{
+  uint32_t savedPRIMASK;
+  __asm volatile ("MRS %[savedPRIMASK], PRIMASK\n"
+                  "CPSID i\n"
+                  : [savedPRIMASK] "=r"(savedPRIMASK)
+                  :
+                  : "memory");
+  return savedPRIMASK;
+}
+
+/**
+ * @brief Exit a critical section entered with systemENTER_CRITICAL_FROM_ISR ().
+ * 
+ * @param savedPRIMASK The value returned by the matching systemENTER_CRITICAL_FROM_ISR ().
+ * 
+ * @warning This function should not be called by user code.
+ */
+void RAMFUNC
+systemEXIT_CRITICAL_FROM_ISR (uint32_t savedPRIMASK)
+{
+  __asm volatile ("MSR PRIMASK, %[savedPRIMASK]\n"
+                  :
+                  : [savedPRIMASK] "r"(savedPRIMASK)
+                  : "memory");
 }
@@ -6,14 +6,18 @@
  */
 
 #include "task.h"
+#include "atomic.h"
+#include "high_res_timer.h"
+#include "trace.h"
 
-volatile uint32_t msTicks = 0;
+volatile uint64_t msTicks = 0;
 TaskNode *curTask = NULL;
 TaskNode *readyTasksList[MAX_PRIORITIES] = { NULL };
 
-static uint32_t prvCurTaskIDNum = 0;
+static volatile uint32_t prvCurTaskIDNum = 0;
 static TaskNode *prvNextTask = NULL;
 static TaskNode *prvBlockedTasks = NULL;
+static volatile uint32_t prvWakeRequested = 0;
 static uint32_t idleTaskStack[STACK_SIZE];
 static TCB idleTaskTCB;
 static TCB *idleTaskTCBptr = &idleTaskTCB;
@@ -21,13 +25,34 @@ static TaskNode idleTaskNode;
 static TaskNode *prvIdleTask;
 static TaskNode *idleTaskNodePtr = &idleTaskNode;
 
+/* Defined by the linker script, bound the TaskNodes defined with TASK_DEFINE */
+extern TaskNode _task_table_start[];
+extern TaskNode _task_table_end[];
+
 static STATUS prvAddTaskNodeToReadyList (TaskNode *task);
 static TaskNode *prvGetHighestTaskReadyToExecute ();
 static void prvAddTaskToBlockedList (TaskNode *task);
 static void prvUnblockDelayedTasksReadyToUnblock ();
+static void prvDelayCurTaskUntil (uint64_t wakeTime);
+static void prvUnblockWokenTasks ();
+#if USE_DEADLINE_MONITOR
+static void prvCheckDeadline (TCB *task);
+static void prvCompleteJob (TCB *task, uint64_t nextReleaseTime,
+                            uint32_t period);
+#endif
 static TaskNode *createIdleTask ();
+static void prvAddStaticTasksToReadyList ();
 static void idleTask ();
 static void prvCheckCurTaskForStackOverflow ();
+#if USE_MPU_STACK_GUARD
+static uint32_t prvGetStackGuardRBAR (uint32_t taskStack[]);
+static void prvConfigureMPUStackGuard ();
+static void prvSetStackGuard (TCB *task);
+static void prvEnableStackGuard (TCB *task);
+#endif
+#if USE_PREEMPTION_THRESHOLD
+static void prvRaiseToPreemptionThreshold (TaskNode *task);
+#endif
 
 /**
  * @brief Initializes a task's stack frame.
@@ -82,14 +107,25 @@ createTask (uint32_t taskStack[], void (*taskFunc) (void),
     return STATUS_FAILURE;
   if (priority >= MAX_PRIORITIES)
     return STATUS_FAILURE;
-  if (STACK_SIZE < 18)
+  if (STACK_SIZE < MIN_STACK_SIZE)
     return STATUS_FAILURE;
 
   userAllocatedTCB->sp = initTaskStackFrame (taskStack, taskFunc);
   userAllocatedTCB->priority = priority;
-  userAllocatedTCB->id = prvCurTaskIDNum;
-  prvCurTaskIDNum++;
+  userAllocatedTCB->id = atomicFetchAdd (&prvCurTaskIDNum, 1);
   userAllocatedTCB->stackFrameLowerBoundAddr = &taskStack[0];
+  userAllocatedTCB->wakeRequested = 0;
+  userAllocatedTCB->waitingForWake = 0;
+#if USE_DEADLINE_MONITOR
+  userAllocatedTCB->deadlineMonitor = NULL;
+#endif
+#if USE_PREEMPTION_THRESHOLD
+  userAllocatedTCB->basePriority = priority;
+  userAllocatedTCB->preemptionThreshold = priority;
+#endif
+#if USE_MPU_STACK_GUARD
+  userAllocatedTCB->stackGuardRBAR = prvGetStackGuardRBAR (taskStack);
+#endif
 
   /* Insert at end of tasks linked list */
   userAllocatedTaskNode->taskTCB = userAllocatedTCB;
@@ -99,6 +135,7 @@ createTask (uint32_t taskStack[], void (*taskFunc) (void),
   systemENTER_CRITICAL ();
   {
     resStatus = prvAddTaskNodeToReadyList (userAllocatedTaskNode);
+    TRACE_RECORD (TRACE_EVENT_TASK_CREATE, userAllocatedTCB);
   }
   systemEXIT_CRITICAL ();
 
@@ -111,7 +148,7 @@ createTask (uint32_t taskStack[], void (*taskFunc) (void),
  * 
  * @warning This function should not be called from user code.
  */
-void
+void RAMFUNC
 SysTick_Handler ()
 {
   msTicks++;
@@ -123,6 +160,10 @@ SysTick_Handler ()
       return;
     }
 
+#if USE_DEADLINE_MONITOR
+  prvCheckDeadline (curTask->taskTCB);
+#endif
+
   uint32_t curExecutingPriority = curTask->taskTCB->priority;
 
   TaskNode *highestPriorityPossibleExecute
@@ -132,16 +173,26 @@ SysTick_Handler ()
   if (curExecutingPriority < highestPriorityPossibleExecute->taskTCB->priority)
     {
       prvNextTask = highestPriorityPossibleExecute;
+      TRACE_RECORD (TRACE_EVENT_TICK_PREEMPT, prvNextTask->taskTCB);
       setPendSVPending ();
       return;
     }
 
+#if USE_PREEMPTION_THRESHOLD
+  if (curTask->taskTCB->priority != curTask->taskTCB->basePriority)
+    {
+      /* A task running at its preemption threshold is not time sliced */
+      return;
+    }
+#endif
+
   if (curTask->next == NULL)
     {
       if (highestPriorityPossibleExecute->taskTCB->id != curTask->taskTCB->id)
         {
           /* There is another task of equal priority, time to switch. */
           prvNextTask = highestPriorityPossibleExecute;
+          TRACE_RECORD (TRACE_EVENT_TICK_PREEMPT, prvNextTask->taskTCB);
           setPendSVPending ();
           return;
         }
@@ -150,6 +201,7 @@ SysTick_Handler ()
     {
       /* There is another task of equal priority, time to switch. */
       prvNextTask = curTask->next;
+      TRACE_RECORD (TRACE_EVENT_TICK_PREEMPT, prvNextTask->taskTCB);
       setPendSVPending ();
       return;
     }
@@ -162,10 +214,12 @@ SysTick_Handler ()
  * @note prvNextTask will be set when this interrupt is pended.
  * @warning This function should never be called by user code.
  */
-void
+void RAMFUNC
 PendSV_Handler ()
 {
+#if !USE_MPU_STACK_GUARD
   prvCheckCurTaskForStackOverflow ();
+#endif
 
   uint32_t spToSave;
   __asm volatile ("mrs r0, PSP\n"
@@ -178,8 +232,23 @@ PendSV_Handler ()
   uint32_t nextSP;
   systemENTER_CRITICAL ();
   {
+    if (atomicExchange (&prvWakeRequested, 0))
+      {
+        prvUnblockWokenTasks ();
+      }
+
     nextSP = (uint32_t)prvNextTask->taskTCB->sp;
     curTask = prvNextTask;
+#if USE_PREEMPTION_THRESHOLD
+    prvRaiseToPreemptionThreshold (curTask);
+#endif
+#if USE_MPU_STACK_GUARD
+    prvSetStackGuard (curTask->taskTCB);
+#endif
+    TRACE_RECORD (TRACE_EVENT_TASK_SWITCH_IN, curTask->taskTCB);
+#if USE_DEADLINE_MONITOR
+    prvCheckDeadline (curTask->taskTCB);
+#endif
   }
   systemEXIT_CRITICAL ();
 
@@ -205,6 +274,14 @@ SVC_Handler ()
   TCB *tcbToStart = curTask->taskTCB;
   uint32_t spToStart = (uint32_t)tcbToStart->sp;
 
+#if USE_MPU_STACK_GUARD
+  prvEnableStackGuard (tcbToStart);
+#endif
+  TRACE_RECORD (TRACE_EVENT_TASK_SWITCH_IN, tcbToStart);
+#if USE_DEADLINE_MONITOR
+  prvCheckDeadline (tcbToStart);
+#endif
+
   __asm volatile ("ldr r0, %[sp]\n"
                   "ldmia r0!, {r4-r11}\n"
                   "msr PSP, r0\n"
@@ -217,8 +294,18 @@ SVC_Handler ()
 void
 startScheduler ()
 {
+  prvAddStaticTasksToReadyList ();
   prvIdleTask = createIdleTask ();
+#if USE_MPU_STACK_GUARD
+  prvConfigureMPUStackGuard ();
+#endif
+#if USE_HIGH_RES_TIMER
+  systemHighResTimerInit ();
+#endif
   curTask = prvGetHighestTaskReadyToExecute ();
+#if USE_PREEMPTION_THRESHOLD
+  prvRaiseToPreemptionThreshold (curTask);
+#endif
   __asm volatile ("svc #0");
 }
 
@@ -227,7 +314,7 @@ startScheduler ()
  * 
  * @warning This function should not be called from user code.
  */
-void
+void RAMFUNC
 setPendSVPending ()
 {
   ICSR |= (1 << 28);
@@ -236,57 +323,166 @@ setPendSVPending ()
 void
 taskDelay (uint32_t ticksToDelay)
 {
+  if (ticksToDelay == 0)
+    {
+      return;
+    }
+
   systemENTER_CRITICAL ();
   {
-    uint32_t curTaskID = curTask->taskTCB->id;
-    uint32_t curTaskPriority = curTask->taskTCB->priority;
+    prvDelayCurTaskUntil (msTicks + ticksToDelay);
+  }
+  systemEXIT_CRITICAL ();
+  setPendSVPending ();
+}
 
-    curTask->taskTCB->delayedUntil = msTicks + ticksToDelay;
+void
+taskDelayUntil (uint64_t *lastWakeTime, uint32_t period)
+{
+  systemENTER_CRITICAL ();
+  {
+    uint64_t nextWakeTime = *lastWakeTime + period;
+    *lastWakeTime = nextWakeTime;
 
-    /* Remove the task from the ready list */
-    TaskNode *cur = readyTasksList[curTaskPriority];
-    TaskNode *prev = NULL;
+#if USE_DEADLINE_MONITOR
+    prvCompleteJob (curTask->taskTCB, nextWakeTime, period);
+#endif
 
-    if (cur->next == NULL)
+    if (nextWakeTime <= msTicks)
       {
-        /* This is the only task for this priority, and it must be curTask */
-        readyTasksList[curTaskPriority] = NULL;
-        prvNextTask = prvGetHighestTaskReadyToExecute ();
-        prvAddTaskToBlockedList (curTask);
+        /* The release time has already passed, so the task must not block */
         systemEXIT_CRITICAL ();
-        setPendSVPending ();
         return;
       }
 
-    /* Check if curTask is the head of the priority */
-    if (cur->taskTCB->id == curTaskID)
-      {
-        readyTasksList[curTaskPriority] = curTask->next;
+    prvDelayCurTaskUntil (nextWakeTime);
+  }
+  systemEXIT_CRITICAL ();
+  setPendSVPending ();
+}
 
-        prvNextTask = prvGetHighestTaskReadyToExecute ();
-        prvAddTaskToBlockedList (curTask);
+uint64_t
+getTickCount ()
+{
+  /*
+   * msTicks is only written by SysTick_Handler, which always finishes
+   * both halves before a task runs again. Re-reading the high half
+   * detects a tick that happened between the two loads.
+   * */
+  volatile uint32_t *msTicksHalves = (volatile uint32_t *)&msTicks;
+  uint32_t high;
+  uint32_t low;
+
+  do
+    {
+      high = atomicLoad (&msTicksHalves[1]);
+      low = atomicLoad (&msTicksHalves[0]);
+    }
+  while (high != atomicLoad (&msTicksHalves[1]));
+
+  return ((uint64_t)high << 32) | low;
+}
+
+void
+systemBlockCurTaskUntilWoken (uint64_t wakeTime)
+{
+  systemENTER_CRITICAL ();
+  {
+    if (atomicExchange (&curTask->taskTCB->wakeRequested, 0))
+      {
         systemEXIT_CRITICAL ();
-        setPendSVPending ();
         return;
       }
 
-    /* There is more than one task for the current priority */
-    while (cur->taskTCB->id != curTaskID)
+    if (wakeTime <= msTicks)
       {
-        prev = cur;
-        cur = cur->next;
+        systemEXIT_CRITICAL ();
+        return;
       }
 
-    TaskNode *afterCur = cur->next;
-    prev->next = afterCur;
-
-    prvNextTask = prvGetHighestTaskReadyToExecute ();
-    prvAddTaskToBlockedList (curTask);
+    curTask->taskTCB->waitingForWake = 1;
+    prvDelayCurTaskUntil (wakeTime);
   }
   systemEXIT_CRITICAL ();
   setPendSVPending ();
 }
 
+void
+systemWakeTaskFromISR (TaskNode *task)
+{
+  atomicSetBits (&task->taskTCB->wakeRequested, WAKE_REQUESTED);
+  prvWakeRequested = 1;
+
+  if (curTask != NULL)
+    {
+      setPendSVPending ();
+    }
+}
+
+void
+systemWakeTaskFromISRAndPreempt (TaskNode *task)
+{
+  atomicSetBits (&task->taskTCB->wakeRequested,
+                 WAKE_REQUESTED | WAKE_PREEMPTS_EQUAL);
+  prvWakeRequested = 1;
+
+  if (curTask != NULL)
+    {
+      setPendSVPending ();
+    }
+}
+
+/**
+ * @brief This function will move the current task from the ready list to the blocked list until wakeTime.
+ * 
+ * @param wakeTime The value of msTicks at which the task will be unblocked.
+ * 
+ * @note This function must be called inside a critical section. The caller must pend PendSV after exiting the critical section.
+ * 
+ * @warning This function should not be called by user code.
+ */
+static void
+prvDelayCurTaskUntil (uint64_t wakeTime)
+{
+  uint32_t curTaskID = curTask->taskTCB->id;
+  uint32_t curTaskPriority = curTask->taskTCB->priority;
+
+  curTask->taskTCB->delayedUntil = wakeTime;
+  TRACE_RECORD (TRACE_EVENT_TASK_DELAY, curTask->taskTCB);
+
+  /* Remove the task from the ready list */
+  TaskNode *cur = readyTasksList[curTaskPriority];
+  TaskNode *prev = NULL;
+
+  if (cur->next == NULL)
+    {
+      /* This is the only task for this priority, and it must be curTask */
+      readyTasksList[curTaskPriority] = NULL;
+    }
+  else if (cur->taskTCB->id == curTaskID)
+    {
+      /* curTask is the head of the priority */
+      readyTasksList[curTaskPriority] = curTask->next;
+    }
+  else
+    {
+      /* There is more than one task for the current priority */
+      while (cur->taskTCB->id != curTaskID)
+        {
+          prev = cur;
+          cur = cur->next;
+        }
+
+      prev->next = cur->next;
+    }
+
+#if USE_PREEMPTION_THRESHOLD
+  curTask->taskTCB->priority = curTask->taskTCB->basePriority;
+#endif
+  prvNextTask = prvGetHighestTaskReadyToExecute ();
+  prvAddTaskToBlockedList (curTask);
+}
+
 /**
  * @brief Add a task to the ready tasks list.
  * 
@@ -296,7 +492,7 @@ taskDelay (uint32_t ticksToDelay)
  * 
  * @warning This function should not be called from user code.
  */
-static STATUS
+static STATUS RAMFUNC
 prvAddTaskNodeToReadyList (TaskNode *task)
 {
   /* Safeguards */
@@ -306,6 +502,8 @@ prvAddTaskNodeToReadyList (TaskNode *task)
     }
 
   task->next = NULL;
+  /* A ready task is not waiting, whether it was woken or timed out */
+  task->taskTCB->waitingForWake = 0;
 
   uint32_t curPriority = task->taskTCB->priority;
 
@@ -335,7 +533,7 @@ prvAddTaskNodeToReadyList (TaskNode *task)
  * 
  * @warning This function should not be called by user code.
  */
-static TaskNode *
+static RAMFUNC TaskNode *
 prvGetHighestTaskReadyToExecute ()
 {
   int idx = MAX_PRIORITIES - 1;
@@ -359,7 +557,7 @@ prvGetHighestTaskReadyToExecute ()
  * 
  * @warning This function should not be called by user code.
  */
-static void
+static void RAMFUNC
 prvAddTaskToBlockedList (TaskNode *task)
 {
   task->next = NULL;
@@ -387,7 +585,7 @@ prvAddTaskToBlockedList (TaskNode *task)
  * 
  * @warning This function should not be called by user code.
  */
-static void
+static void RAMFUNC
 prvUnblockDelayedTasksReadyToUnblock ()
 {
   TaskNode *cur = prvBlockedTasks;
@@ -400,10 +598,11 @@ prvUnblockDelayedTasksReadyToUnblock ()
 
   if (cur->next == NULL)
     {
-      if (cur->taskTCB->delayedUntil == msTicks)
+      if (cur->taskTCB->delayedUntil <= msTicks)
         {
           prvBlockedTasks = NULL;
           prvAddTaskNodeToReadyList (cur);
+          TRACE_RECORD (TRACE_EVENT_TASK_UNBLOCK, cur->taskTCB);
           return;
         }
     }
@@ -411,17 +610,78 @@ prvUnblockDelayedTasksReadyToUnblock ()
   while (cur != NULL)
     {
       TaskNode *tempNext = cur->next;
-      if (cur->taskTCB->delayedUntil == msTicks)
+      if (cur->taskTCB->delayedUntil <= msTicks)
         {
           if (prev == NULL)
             {
               prvBlockedTasks = cur->next;
               prvAddTaskNodeToReadyList (cur);
+              TRACE_RECORD (TRACE_EVENT_TASK_UNBLOCK, cur->taskTCB);
             }
           else
             {
               prev->next = cur->next;
               prvAddTaskNodeToReadyList (cur);
+              TRACE_RECORD (TRACE_EVENT_TASK_UNBLOCK, cur->taskTCB);
+            }
+        }
+      else
+        {
+          prev = cur;
+        }
+      cur = tempNext;
+    }
+}
+
+/**
+ * @brief This function will move every task blocked in systemBlockCurTaskUntilWoken () with a pending wake request to the ready list.
+ * @details If a woken task has a higher priority than prvNextTask, it becomes prvNextTask. A task woken with WAKE_PREEMPTS_EQUAL
+ * also becomes prvNextTask over one of equal priority that is not running at a preemption threshold.
+ * When PendSV was only pended for a wake request, prvNextTask is still curTask, so the woken task preempts curTask.
+ * 
+ * @note This function is called from PendSV_Handler inside a critical section, after it cleared prvWakeRequested with
+ * atomicExchange (), so a wake request made during the scan pends PendSV again.
+ * 
+ * @warning This function should not be called by user code.
+ */
+static void RAMFUNC
+prvUnblockWokenTasks ()
+{
+  TaskNode *cur = prvBlockedTasks;
+  TaskNode *prev = NULL;
+
+  while (cur != NULL)
+    {
+      TaskNode *tempNext = cur->next;
+      uint32_t wakeRequested = atomicExchange (&cur->taskTCB->wakeRequested, 0);
+      if (wakeRequested && !cur->taskTCB->waitingForWake)
+        {
+          /*
+           * Left over from a wait that already ended, for example by
+           * timing out. The task is in a plain taskDelay (), so ignore it.
+           * */
+          prev = cur;
+        }
+      else if (wakeRequested)
+        {
+          if (prev == NULL)
+            {
+              prvBlockedTasks = tempNext;
+            }
+          else
+            {
+              prev->next = tempNext;
+            }
+          prvAddTaskNodeToReadyList (cur);
+          TRACE_RECORD (TRACE_EVENT_TASK_UNBLOCK, cur->taskTCB);
+
+          TCB *nextTCB = prvNextTask->taskTCB;
+          if (cur->taskTCB->priority > nextTCB->priority
+              || ((wakeRequested & WAKE_PREEMPTS_EQUAL)
+                  && cur->taskTCB->priority == nextTCB->priority
+                  && nextTCB->priority == systemTASK_BASE_PRIORITY (nextTCB)))
+            {
+              prvNextTask = cur;
             }
         }
       else
@@ -444,15 +704,78 @@ createIdleTask ()
 {
   idleTaskTCBptr->sp = initTaskStackFrame (idleTaskStack, &idleTask);
   idleTaskTCBptr->priority = 0;
-  idleTaskTCBptr->id = prvCurTaskIDNum;
+  idleTaskTCBptr->id = atomicFetchAdd (&prvCurTaskIDNum, 1);
   idleTaskTCBptr->stackFrameLowerBoundAddr = &idleTaskStack[0];
+  idleTaskTCBptr->wakeRequested = 0;
+  idleTaskTCBptr->waitingForWake = 0;
+#if USE_DEADLINE_MONITOR
+  idleTaskTCBptr->deadlineMonitor = NULL;
+#endif
+#if USE_PREEMPTION_THRESHOLD
+  idleTaskTCBptr->basePriority = 0;
+  idleTaskTCBptr->preemptionThreshold = 0;
+#endif
+#if USE_MPU_STACK_GUARD
+  idleTaskTCBptr->stackGuardRBAR = prvGetStackGuardRBAR (idleTaskStack);
+#endif
   idleTaskNodePtr->taskTCB = idleTaskTCBptr;
   idleTaskNodePtr->next = NULL;
-  prvCurTaskIDNum++;
 
   return idleTaskNodePtr;
 }
 
+/**
+ * @brief This function will add every task defined with TASK_DEFINE to the ready list.
+ * @details The stacks, TCBs and TaskNodes are already initialized at compile time, so only the task ID is assigned here.
+ * Each TaskNode is appended to the tail of its priority's list in constant time.
+ * 
+ * @warning This function should not be called by user code.
+ */
+static void
+prvAddStaticTasksToReadyList ()
+{
+  TaskNode *tails[MAX_PRIORITIES];
+
+  for (uint32_t i = 0; i < MAX_PRIORITIES; ++i)
+    {
+      tails[i] = readyTasksList[i];
+      while (tails[i] != NULL && tails[i]->next != NULL)
+        {
+          tails[i] = tails[i]->next;
+        }
+    }
+
+  for (TaskNode *task = _task_table_start; task < _task_table_end; ++task)
+    {
+      uint32_t priority = task->taskTCB->priority;
+
+      task->taskTCB->id = atomicFetchAdd (&prvCurTaskIDNum, 1);
+#if USE_PREEMPTION_THRESHOLD
+      /* TASK_DEFINE leaves the threshold 0 unless it was set */
+      task->taskTCB->basePriority = priority;
+      if (task->taskTCB->preemptionThreshold < priority)
+        {
+          task->taskTCB->preemptionThreshold = priority;
+        }
+#endif
+#if USE_MPU_STACK_GUARD
+      task->taskTCB->stackGuardRBAR
+          = prvGetStackGuardRBAR (task->taskTCB->stackFrameLowerBoundAddr);
+#endif
+
+      if (tails[priority] == NULL)
+        {
+          readyTasksList[priority] = task;
+        }
+      else
+        {
+          tails[priority]->next = task;
+        }
+      tails[priority] = task;
+      TRACE_RECORD (TRACE_EVENT_TASK_CREATE, task->taskTCB);
+    }
+}
+
 /**
  * @brief This function is the Idle Task. It will run when no other task is ready to run.
  * 
@@ -474,25 +797,22 @@ idleTask ()
  * 
  * @warning This function should not be called by user code.
  */
-static void
+static void RAMFUNC
 prvCheckCurTaskForStackOverflow ()
 {
-  uint32_t *curTaskStackFrameLowerBound;
-  systemENTER_CRITICAL ();
-  {
-    curTaskStackFrameLowerBound = curTask->taskTCB->stackFrameLowerBoundAddr;
-  }
-  systemEXIT_CRITICAL ();
+  /* curTask is only changed by PendSV_Handler, which is the caller */
+  uint32_t *curTaskStackFrameLowerBound
+      = curTask->taskTCB->stackFrameLowerBoundAddr;
 
   if ((*curTaskStackFrameLowerBound != STACK_OVERFLOW_CANARY_VALUE)
       || (*(curTaskStackFrameLowerBound + 1) != STACK_OVERFLOW_CANARY_VALUE))
     {
-      handleStackOverflow ();
+      handleStackOverflow (curTask->taskTCB);
     }
 }
 
 void __attribute__ ((weak))
-handleStackOverflow ()
+handleStackOverflow (__attribute__ ((unused)) TCB *overflowedTask)
 {
   for (;;)
     {
@@ -502,15 +822,25 @@ handleStackOverflow ()
 uint32_t
 getCurTaskWordsAvailable ()
 {
+  /*
+   * No critical section is needed, curTask always points to the calling
+   * task while it runs, and its TCB does not change after creation.
+   * */
   uint32_t *curTaskStackFrameLowerBound;
-  systemENTER_CRITICAL ();
-  {
-    curTaskStackFrameLowerBound = curTask->taskTCB->stackFrameLowerBoundAddr;
-  }
-  systemEXIT_CRITICAL ();
-
+#if USE_MPU_STACK_GUARD
+  /* Start above the guard region, reading it would fault */
+  curTaskStackFrameLowerBound
+      = (uint32_t *)((curTask->taskTCB->stackGuardRBAR
+                      & ~(MPU_STACK_GUARD_SIZE_BYTES - 1U))
+                     + MPU_STACK_GUARD_SIZE_BYTES);
+#else
+  curTaskStackFrameLowerBound = curTask->taskTCB->stackFrameLowerBoundAddr;
+#endif
+
+#if !USE_MPU_STACK_GUARD
   curTaskStackFrameLowerBound
       += 2; /* Skip the 2 canary values (assumes no stack overflow) */
+#endif
 
   uint32_t amtWordsAvailable = 0;
 
@@ -522,3 +852,288 @@ getCurTaskWordsAvailable ()
 
   return amtWordsAvailable;
 }
+
+#if USE_DEADLINE_MONITOR
+STATUS
+setTaskDeadline (TCB *task, DeadlineMonitor *userAllocatedMonitor,
+                 uint32_t period, uint32_t relativeDeadline)
+{
+  if (!task || !userAllocatedMonitor || period == 0 || relativeDeadline == 0)
+    return STATUS_FAILURE;
+
+  userAllocatedMonitor->period = period;
+  userAllocatedMonitor->relativeDeadline = relativeDeadline;
+  userAllocatedMonitor->releaseTime = 0;
+  userAllocatedMonitor->absoluteDeadline = 0;
+  userAllocatedMonitor->released = 0;
+  userAllocatedMonitor->missFlagged = 0;
+  userAllocatedMonitor->missCount = 0;
+  userAllocatedMonitor->periodMismatchCount = 0;
+  userAllocatedMonitor->completedJobs = 0;
+  userAllocatedMonitor->worstResponseTime = 0;
+  userAllocatedMonitor->bestResponseTime = UINT32_MAX;
+  userAllocatedMonitor->jitter = 0;
+
+  /* A single aligned word store, so no critical section is needed. The
+     barrier keeps the monitor's initialisation ahead of the store that lets
+     SysTick see it. */
+  __asm volatile ("" ::: "memory");
+  task->deadlineMonitor = userAllocatedMonitor;
+
+  return STATUS_SUCCESS;
+}
+
+/**
+ * @brief This function will count a deadline miss if a task's current job is past its deadline.
+ * @details The first check of a task happens when it is first switched in, which releases its first job.
+ * 
+ * @param task The TCB of the task to check.
+ * 
+ * @note A job's miss is only counted once, no matter how many times it is checked.
+ * 
+ * @warning This function should not be called by user code.
+ */
+static void
+prvCheckDeadline (TCB *task)
+{
+  DeadlineMonitor *monitor = task->deadlineMonitor;
+
+  if (monitor == NULL || monitor->missFlagged)
+    {
+      return;
+    }
+
+  if (!monitor->released)
+    {
+      monitor->releaseTime = msTicks;
+      monitor->absoluteDeadline = msTicks + monitor->relativeDeadline;
+      monitor->released = 1;
+      return;
+    }
+
+  if (msTicks > monitor->absoluteDeadline)
+    {
+      monitor->missFlagged = 1;
+      monitor->missCount++;
+      deadlineMissHook (task);
+    }
+}
+
+/**
+ * @brief This function will record the completion of a task's current job and release its next job.
+ * 
+ * @param task The TCB of the task whose job completed.
+ * @param nextReleaseTime The release time of the task's next job.
+ * @param period The period passed to taskDelayUntil (), which is counted as a mismatch if it differs from the registered period.
+ * 
+ * @note This function is called from taskDelayUntil () inside a critical section.
+ * 
+ * @warning This function should not be called by user code.
+ */
+static void
+prvCompleteJob (TCB *task, uint64_t nextReleaseTime, uint32_t period)
+{
+  DeadlineMonitor *monitor = task->deadlineMonitor;
+
+  if (monitor == NULL)
+    {
+      return;
+    }
+
+  if (period != monitor->period)
+    {
+      monitor->periodMismatchCount++;
+    }
+
+  prvCheckDeadline (task);
+
+  uint32_t responseTime = (uint32_t)(msTicks - monitor->releaseTime);
+  if (responseTime > monitor->worstResponseTime)
+    {
+      monitor->worstResponseTime = responseTime;
+    }
+  if (responseTime < monitor->bestResponseTime)
+    {
+      monitor->bestResponseTime = responseTime;
+    }
+  monitor->jitter = monitor->worstResponseTime - monitor->bestResponseTime;
+  monitor->completedJobs++;
+
+  monitor->releaseTime = nextReleaseTime;
+  monitor->absoluteDeadline = nextReleaseTime + monitor->relativeDeadline;
+  monitor->missFlagged = 0;
+}
+
+void __attribute__ ((weak))
+deadlineMissHook (__attribute__ ((unused)) TCB *task)
+{
+}
+#endif
+
+#if USE_PREEMPTION_THRESHOLD
+STATUS
+setTaskPreemptionThreshold (TCB *task, uint32_t threshold)
+{
+  if (!task || threshold >= MAX_PRIORITIES || threshold < task->priority)
+    return STATUS_FAILURE;
+
+  task->preemptionThreshold = threshold;
+  return STATUS_SUCCESS;
+}
+
+/**
+ * @brief This function will move a task that is being switched in to the head of its preemption threshold's ready list.
+ * @details The task keeps the threshold as its priority until it blocks, even while a higher priority task preempts it,
+ * so no task at or below the threshold can run in between. Putting it at the head of the list makes it the first
+ * task of that priority to resume.
+ * 
+ * @note This function is called with SysTick and PendSV masked.
+ * @warning This function should not be called by user code.
+ */
+static void RAMFUNC
+prvRaiseToPreemptionThreshold (TaskNode *task)
+{
+  TCB *tcb = task->taskTCB;
+  if (tcb->priority >= tcb->preemptionThreshold)
+    {
+      return;
+    }
+
+  TaskNode **link = &readyTasksList[tcb->priority];
+  while (*link != task)
+    {
+      link = &(*link)->next;
+    }
+  *link = task->next;
+
+  tcb->priority = tcb->preemptionThreshold;
+  task->next = readyTasksList[tcb->priority];
+  readyTasksList[tcb->priority] = task;
+}
+#endif
+
+#if USE_MPU_STACK_GUARD
+/**
+ * @brief This function will compute the MPU_RBAR value of a task's stack guard.
+ * @details The guard is placed at the first MPU_STACK_GUARD_SIZE_BYTES aligned address in the task's stack,
+ * since MPU regions must be aligned to their size.
+ * 
+ * @param taskStack The user-defined array of size STACK_SIZE
+ * 
+ * @return Returns the guard's base address with the VALID bit and region number set, so a single write to MPU_RBAR moves the guard.
+ * 
+ * @warning This function should not be called by user code.
+ */
+static uint32_t
+prvGetStackGuardRBAR (uint32_t taskStack[])
+{
+  uint32_t guardBase
+      = ((uint32_t)taskStack + (MPU_STACK_GUARD_SIZE_BYTES - 1U))
+        & ~(MPU_STACK_GUARD_SIZE_BYTES - 1U);
+
+  return guardBase | (1U << MPU_RBAR_VALID_BIT) | MPU_STACK_GUARD_REGION;
+}
+
+/**
+ * @brief This function will configure the stack guard region and enable the MPU and the MemManage fault.
+ * 
+ * @note The default memory map stays enabled for privileged code, so the stack guard is the only region that restricts access.
+ * The region is left disabled, since it has no stack to guard yet, until prvEnableStackGuard () starts the first task.
+ * @warning This function should not be called by user code.
+ */
+static void
+prvConfigureMPUStackGuard ()
+{
+  MPU_CTRL = 0;
+
+  /* No access, execute never, 2^(4 + 1) = 32 bytes */
+  MPU_RNR = MPU_STACK_GUARD_REGION;
+  MPU_RBAR = 0;
+  MPU_RASR = (1U << MPU_RASR_XN_BIT) | (4U << MPU_RASR_SIZE_BIT_START);
+
+  SCB_SHCSR |= (1U << SCB_SHCSR_MEMFAULTENA_BIT);
+  MPU_CTRL = (1U << MPU_CTRL_PRIVDEFENA_BIT) | (1U << MPU_CTRL_ENABLE_BIT);
+
+  __asm volatile ("dsb\n"
+                  "isb\n");
+}
+
+/**
+ * @brief This function will move the stack guard to the bottom of a task's stack.
+ * 
+ * @param task The TCB of the task that is being switched in.
+ * 
+ * @warning This function should not be called by user code.
+ */
+static void RAMFUNC
+prvSetStackGuard (TCB *task)
+{
+  MPU_RBAR = task->stackGuardRBAR;
+
+  __asm volatile ("dsb\n"
+                  "isb\n");
+}
+
+/**
+ * @brief This function will place the stack guard at the bottom of the first task's stack and enable it.
+ * 
+ * @param task The TCB of the first task to run.
+ * 
+ * @warning This function should not be called by user code.
+ */
+static void
+prvEnableStackGuard (TCB *task)
+{
+  /* The valid bit in the RBAR value also selects the guard region in RNR */
+  MPU_RBAR = task->stackGuardRBAR;
+  MPU_RASR |= (1U << MPU_RASR_ENABLE_BIT);
+
+  __asm volatile ("dsb\n"
+                  "isb\n");
+}
+
+void
+systemHandle_MemManage (uint32_t *faultSP, uint32_t *calleeSavedRegs)
+{
+  uint32_t cfsr = SCB_CFSR;
+  uint32_t guardStart = curTask->taskTCB->stackGuardRBAR
+                        & ~(MPU_STACK_GUARD_SIZE_BYTES - 1U);
+  uint32_t guardEnd = guardStart + MPU_STACK_GUARD_SIZE_BYTES;
+  uint32_t hitGuard = 0;
+
+  if (cfsr & (1U << SCB_CFSR_MSTKERR_BIT))
+    {
+      /* MMFAR is not valid for a stacking fault, and the stack pointer may
+         or may not have been moved past the frame that failed to stack */
+      uint32_t sp = (uint32_t)faultSP;
+      hitGuard = sp > guardStart - EXCEPTION_FRAME_MAX_BYTES
+                 && sp < guardEnd + EXCEPTION_FRAME_MAX_BYTES;
+    }
+  else if ((cfsr & (1U << SCB_CFSR_DACCVIOL_BIT))
+           && (cfsr & (1U << SCB_CFSR_MMARVALID_BIT)))
+    {
+      uint32_t address = SCB_MMFAR;
+      hitGuard = address >= guardStart && address < guardEnd;
+    }
+
+  if (hitGuard)
+    {
+      handleStackOverflow (curTask->taskTCB);
+    }
+
+  /* Returning would retry the faulting access and fault again, so a
+     handleStackOverflow () that returns ends in the fault log as well */
+  systemHandle_Fault (faultSP, calleeSavedRegs);
+}
+
+__attribute__ ((naked)) void
+MemManage_Handler ()
+{
+  __asm volatile ("MOV r0, lr\n"
+                  "BL systemGet_Fault_SP\n"
+                  "PUSH {r4-r11}\n"
+                  "MOV r1, sp\n"
+                  "LDR r2, =systemHandle_MemManage\n"
+                  "BX r2\n");
+}
+#endif
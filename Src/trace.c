@@ -0,0 +1,55 @@
+/**
+ * @file    trace.c
+ * @brief   Scheduler event trace recorder for SRTOS.
+ * @details
+ * Implements the fixed-size binary trace ring buffer written by the kernel
+ * when `USE_TRACE` is enabled.
+ */
+
+#include "trace.h"
+
+#if USE_TRACE
+
+_Static_assert ((TRACE_BUFFER_RECORDS & (TRACE_BUFFER_RECORDS - 1U)) == 0,
+                "TRACE_BUFFER_RECORDS must be a power of 2");
+
+TraceBuffer traceBuffer;
+
+/**
+ * @brief This function will start the DWT cycle counter and mark the trace buffer as valid.
+ * 
+ * @warning This function should not be called by user code.
+ */
+static void
+prvTraceInit ()
+{
+  DEMCR |= (1U << DEMCR_TRCENA_BIT);
+  DWT_CYCCNT = 0;
+  DWT_CTRL |= (1U << DWT_CTRL_CYCCNTENA_BIT);
+
+  traceBuffer.capacity = TRACE_BUFFER_RECORDS;
+  traceBuffer.writeIndex = 0;
+  traceBuffer.magic = TRACE_BUFFER_MAGIC;
+}
+
+void
+traceRecordEvent (TRACE_EVENT event, TCB *task)
+{
+  if (traceBuffer.magic != TRACE_BUFFER_MAGIC)
+    {
+      prvTraceInit ();
+    }
+
+  uint32_t index = traceBuffer.writeIndex;
+  TraceRecord *record
+      = &traceBuffer.records[index & (TRACE_BUFFER_RECORDS - 1U)];
+
+  record->timestamp = DWT_CYCCNT;
+  record->event = (uint8_t)event;
+  record->priority = (uint8_t)systemTASK_BASE_PRIORITY (task);
+  record->taskID = (uint16_t)task->id;
+
+  traceBuffer.writeIndex = index + 1U;
+}
+
+#endif
@@ -0,0 +1,118 @@
+/**
+ * @file    work_queue.c
+ * @brief   Deferred interrupt work queue for SRTOS.
+ * @details
+ * Implements a bounded lock-free multi-producer single-consumer queue of
+ * work items, and the worker task that drains it.
+ */
+
+#include "work_queue.h"
+#include "atomic.h"
+
+#if USE_WORK_QUEUE
+
+_Static_assert ((WORK_QUEUE_LENGTH & (WORK_QUEUE_LENGTH - 1U)) == 0,
+                "WORK_QUEUE_LENGTH must be a power of 2");
+/* With one slot, a posted slot's sequence equals the free value of the next
+   position, so a producer would overwrite an item that was not consumed */
+_Static_assert (WORK_QUEUE_LENGTH >= 2U,
+                "WORK_QUEUE_LENGTH must be at least 2");
+
+static void prvWorkQueueTask ();
+
+TASK_DEFINE (workQueue, prvWorkQueueTask, WORK_QUEUE_TASK_PRIORITY,
+             WORK_QUEUE_STACK_SIZE);
+
+static WorkItem prvWorkItems[WORK_QUEUE_LENGTH];
+static volatile uint32_t prvEnqueuePos = 0;
+static uint32_t prvDequeuePos = 0;
+
+/**
+ * @brief This function will return the sequence value of a free slot for a queue position.
+ * @details Sequences are stored relative to the slot index, so the zero-initialized queue starts with every slot free.
+ * A slot holding a posted item has the free value plus 1, and a consumed slot has the free value of the next lap.
+ * 
+ * @param pos The enqueue or dequeue position
+ * 
+ * @warning This function should not be called by user code.
+ */
+static inline uint32_t
+prvFreeSequence (uint32_t pos)
+{
+  return pos & ~(WORK_QUEUE_LENGTH - 1U);
+}
+
+STATUS
+workQueuePostFromISR (void (*workFunc) (void *), void *arg)
+{
+  if (!workFunc)
+    return STATUS_FAILURE;
+
+  uint32_t pos = atomicLoad (&prvEnqueuePos);
+  WorkItem *item;
+
+  /* Reserve a slot, retrying if a nested ISR reserved it first */
+  for (;;)
+    {
+      item = &prvWorkItems[pos & (WORK_QUEUE_LENGTH - 1U)];
+      int32_t diff
+          = (int32_t)(atomicLoad (&item->sequence) - prvFreeSequence (pos));
+
+      if (diff < 0)
+        {
+          /* The worker has not consumed this slot yet, the queue is full */
+          return STATUS_FAILURE;
+        }
+
+      if (diff == 0
+          && atomicCompareAndSwap (&prvEnqueuePos, pos, pos + 1U))
+        {
+          break;
+        }
+
+      pos = atomicLoad (&prvEnqueuePos);
+    }
+
+  item->workFunc = workFunc;
+  item->arg = arg;
+  atomicStore (&item->sequence, prvFreeSequence (pos) + 1U);
+
+  systemWakeTaskFromISR (&workQueueNode);
+  return STATUS_SUCCESS;
+}
+
+/**
+ * @brief This function is the work queue's worker task. It runs every posted work item in order, then blocks until more work is posted.
+ * 
+ * @note An item whose slot was reserved but not yet filled by an interrupted ISR ends the batch. That ISR wakes the worker again once it finishes posting.
+ * @warning This function should not be called by user code.
+ */
+static void
+prvWorkQueueTask ()
+{
+  for (;;)
+    {
+      for (;;)
+        {
+          WorkItem *item
+              = &prvWorkItems[prvDequeuePos & (WORK_QUEUE_LENGTH - 1U)];
+          if (atomicLoad (&item->sequence)
+              != prvFreeSequence (prvDequeuePos) + 1U)
+            {
+              break;
+            }
+
+          void (*workFunc) (void *) = item->workFunc;
+          void *arg = item->arg;
+          atomicStore (&item->sequence,
+                       prvFreeSequence (prvDequeuePos) + WORK_QUEUE_LENGTH);
+          prvDequeuePos++;
+
+          workFunc (arg);
+        }
+
+      systemBlockCurTaskUntilWoken (DELAYED_FOREVER);
+    }
+}
+
+#endif
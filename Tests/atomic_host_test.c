@@ -0,0 +1,143 @@
+/**
+ * @file    atomic_host_test.c
+ * @brief   Host contention test of the atomic.h primitives.
+ * @details
+ * Runs several threads that hammer atomicFetchAdd (), atomicCompareAndSwap (),
+ * atomicSetBits (), atomicClearBits () and the lock-free stack at once, then
+ * checks that no update or node was lost. It uses the host fallback of
+ * atomic.h, so it checks the API contract rather than the LDREX/STREX code.
+ * Build and run it with `make atomic-test`.
+ */
+
+#include "atomic.h"
+#include <pthread.h>
+#include <stdio.h>
+
+#define THREADS 4U
+#define ITERATIONS 200000U
+#define NODES_PER_THREAD 10000U
+
+typedef struct
+{
+  AtomicStackNode node;
+  uint32_t owner;
+} TestNode;
+
+static volatile uint32_t fetchAddCounter = 0;
+static volatile uint32_t casCounter = 0;
+static volatile uint32_t ownedBits = 0;
+static uint32_t bitErrors = 0;
+static AtomicStack stack = { NULL };
+static TestNode nodes[THREADS][NODES_PER_THREAD];
+static uint32_t popped[THREADS];
+
+static void *
+prvPushWorker (void *arg)
+{
+  uint32_t id = (uint32_t)(uintptr_t)arg;
+  uint32_t bit = 1U << id;
+
+  for (uint32_t i = 0; i < ITERATIONS; i++)
+    {
+      atomicFetchAdd (&fetchAddCounter, 1U);
+
+      uint32_t expected;
+      do
+        {
+          expected = atomicLoad (&casCounter);
+        }
+      while (!atomicCompareAndSwap (&casCounter, expected, expected + 1U));
+
+      /* Each thread owns one bit, so it must see the bit clear before it
+         sets it and set before it clears it.  */
+      if (atomicSetBits (&ownedBits, bit) & bit)
+        {
+          __atomic_fetch_add (&bitErrors, 1U, __ATOMIC_RELAXED);
+        }
+      if (!(atomicClearBits (&ownedBits, bit) & bit))
+        {
+          __atomic_fetch_add (&bitErrors, 1U, __ATOMIC_RELAXED);
+        }
+    }
+
+  for (uint32_t i = 0; i < NODES_PER_THREAD; i++)
+    {
+      nodes[id][i].owner = id;
+      atomicStackPush (&stack, &nodes[id][i].node);
+    }
+
+  return NULL;
+}
+
+/*
+ * Pops run in a separate phase from the pushes. A node is never pushed again,
+ * so the ABA problem of the host compare-and-swap fallback can not occur.
+ * */
+static void *
+prvPopWorker (void *arg)
+{
+  (void)arg;
+  AtomicStackNode *node;
+
+  while ((node = atomicStackPop (&stack)) != NULL)
+    {
+      __atomic_fetch_add (&popped[((TestNode *)node)->owner], 1U,
+                          __ATOMIC_RELAXED);
+    }
+
+  return NULL;
+}
+
+static void
+prvRunThreads (void *(*worker) (void *))
+{
+  pthread_t threads[THREADS];
+
+  for (uint32_t i = 0; i < THREADS; i++)
+    {
+      pthread_create (&threads[i], NULL, worker, (void *)(uintptr_t)i);
+    }
+  for (uint32_t i = 0; i < THREADS; i++)
+    {
+      pthread_join (threads[i], NULL);
+    }
+}
+
+int
+main (void)
+{
+  int failures = 0;
+
+  prvRunThreads (prvPushWorker);
+  prvRunThreads (prvPopWorker);
+
+  if (fetchAddCounter != THREADS * ITERATIONS)
+    {
+      printf ("atomicFetchAdd: %u, expected %u\n", fetchAddCounter,
+              THREADS * ITERATIONS);
+      failures++;
+    }
+  if (casCounter != THREADS * ITERATIONS)
+    {
+      printf ("atomicCompareAndSwap: %u, expected %u\n", casCounter,
+              THREADS * ITERATIONS);
+      failures++;
+    }
+  if (bitErrors != 0 || ownedBits != 0)
+    {
+      printf ("atomicSetBits/atomicClearBits: %u lost updates\n", bitErrors);
+      failures++;
+    }
+  for (uint32_t i = 0; i < THREADS; i++)
+    {
+      if (popped[i] != NODES_PER_THREAD)
+        {
+          printf ("atomicStack: popped %u nodes of thread %u, expected %u\n",
+                  popped[i], i, NODES_PER_THREAD);
+          failures++;
+        }
+    }
+
+  printf ("%s\n", failures ? "FAIL" : "PASS");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,197 @@
+/**
+ * @file    atomic_target_test.c
+ * @brief   On-target contention test of the atomic.h LDREX/STREX primitives.
+ * @details
+ * Build it in place of the application's main file. Two tasks of equal
+ * priority round-robin on every SysTick while a TIM5 update interrupt at the
+ * highest priority fires every few microseconds. All three update the same
+ * counters and pop and push the same lock-free stack, so exceptions land
+ * between LDREX and STREX and force the retries. When both tasks finish,
+ * the counters are checked: the green LED (PD12) means pass and the orange
+ * LED (PD13) means fail. atomicTestResult holds the same result for a
+ * debugger, 1 for pass and 2 for fail.
+ */
+
+#include "atomic.h"
+#include "config.h"
+#include "gpio.h"
+#include "task.h"
+
+_Static_assert (!USE_HIGH_RES_TIMER,
+                "the test uses TIM5, disable USE_HIGH_RES_TIMER");
+
+#define TASK_ITERATIONS 200000U
+#define STACK_NODES 8U
+/* An update every 5 us */
+#define ISR_PERIOD_CYCLES (HIGH_RES_TIMER_CLOCK_HZ / 200000U)
+
+uint32_t task1Stack[STACK_SIZE];
+uint32_t task2Stack[STACK_SIZE];
+TCB task1TCB;
+TCB task2TCB;
+TaskNode task1Node;
+TaskNode task2Node;
+
+volatile uint32_t atomicTestResult = 0;
+
+static volatile uint32_t prvFetchAddCounter = 0;
+static volatile uint32_t prvCasCounter = 0;
+static volatile uint32_t prvOwnedBits = 0;
+static volatile uint32_t prvBitErrors = 0;
+static volatile uint32_t prvIsrCount = 0;
+static volatile uint32_t prvFinishedTasks = 0;
+static AtomicStack prvStack = { NULL };
+static AtomicStackNode prvNodes[STACK_NODES];
+
+/**
+ * @brief This function will pop a node and push it back.
+ *
+ * @note Every user pushes back what it popped, so all STACK_NODES nodes are on the stack at the end.
+ */
+static void
+prvCycleStack ()
+{
+  AtomicStackNode *node = atomicStackPop (&prvStack);
+  if (node != NULL)
+    {
+      atomicStackPush (&prvStack, node);
+    }
+}
+
+/**
+ * @brief This function will hammer every primitive, owning one bit of prvOwnedBits.
+ */
+static void
+prvContend (uint32_t bit)
+{
+  for (uint32_t i = 0; i < TASK_ITERATIONS; i++)
+    {
+      atomicFetchAdd (&prvFetchAddCounter, 1U);
+
+      uint32_t expected;
+      do
+        {
+          expected = atomicLoad (&prvCasCounter);
+        }
+      while (!atomicCompareAndSwap (&prvCasCounter, expected, expected + 1U));
+
+      if (atomicSetBits (&prvOwnedBits, bit) & bit)
+        {
+          atomicFetchAdd (&prvBitErrors, 1U);
+        }
+      if (!(atomicClearBits (&prvOwnedBits, bit) & bit))
+        {
+          atomicFetchAdd (&prvBitErrors, 1U);
+        }
+
+      prvCycleStack ();
+    }
+}
+
+/**
+ * @brief This function will check the counters once both tasks are done.
+ */
+static void
+prvCheckResult ()
+{
+  TIM5_DIER &= ~(1U << TIM_DIER_UIE_BIT);
+
+  uint32_t nodes = 0;
+  while (atomicStackPop (&prvStack) != NULL)
+    {
+      nodes++;
+    }
+
+  uint32_t passed
+      = prvFetchAddCounter == 2U * TASK_ITERATIONS + prvIsrCount
+        && prvCasCounter == 2U * TASK_ITERATIONS && prvBitErrors == 0
+        && prvOwnedBits == 0 && nodes == STACK_NODES && prvIsrCount > 0;
+
+  atomicTestResult = passed ? 1U : 2U;
+  if (passed)
+    {
+      GPIO_SET (D, 12);
+    }
+  else
+    {
+      GPIO_SET (D, 13);
+    }
+}
+
+static void
+task1_contend ()
+{
+  prvContend (1U << 0);
+  if (atomicFetchAdd (&prvFinishedTasks, 1U) == 1U)
+    {
+      prvCheckResult ();
+    }
+  while (1)
+    {
+      taskDelay (1000);
+    }
+}
+
+static void
+task2_contend ()
+{
+  prvContend (1U << 1);
+  if (atomicFetchAdd (&prvFinishedTasks, 1U) == 1U)
+    {
+      prvCheckResult ();
+    }
+  while (1)
+    {
+      taskDelay (1000);
+    }
+}
+
+void
+TIM5_IRQHandler ()
+{
+  TIM5_SR = ~(1U << TIM_SR_UIF_BIT);
+
+  prvIsrCount++;
+  atomicFetchAdd (&prvFetchAddCounter, 1U);
+  prvCycleStack ();
+}
+
+/**
+ * @brief This function will start the TIM5 update interrupt at the highest priority.
+ */
+static void
+prvStartContendingInterrupt ()
+{
+  RCC_APB1ENR |= (1U << RCC_APB1ENR_TIM5EN_BIT);
+
+  TIM5_PSC = 0;
+  TIM5_ARR = ISR_PERIOD_CYCLES - 1U;
+  TIM5_CNT = 0;
+  TIM5_EGR = (1U << TIM_EGR_UG_BIT);
+  TIM5_SR = 0;
+  TIM5_DIER |= (1U << TIM_DIER_UIE_BIT);
+  TIM5_CR1 |= (1U << TIM_CR1_CEN_BIT);
+
+  NVIC_IPR (TIM5_IRQ_NUMBER) = 0x00;
+  NVIC_ISER (TIM5_IRQ_NUMBER) = (1U << (TIM5_IRQ_NUMBER % 32U));
+}
+
+int
+main (void)
+{
+  configureAll ();
+
+  for (uint32_t i = 0; i < STACK_NODES; i++)
+    {
+      atomicStackPush (&prvStack, &prvNodes[i]);
+    }
+
+  createTask (task1Stack, &task1_contend, 1, &task1TCB, &task1Node);
+  createTask (task2Stack, &task2_contend, 1, &task2TCB, &task2Node);
+
+  prvStartContendingInterrupt ();
+  startScheduler ();
+  while (1)
+    {
+    }
+}
@@ -0,0 +1,203 @@
+/**
+ * @file    event_group_target_bench.c
+ * @brief   On-target benchmark of event group broadcast wakes against flag polling.
+ * @details
+ * Build it in place of the application's main file. For 1, 8 and 32 waiting
+ * tasks, the benchmark task measures the cycles eventGroupSetBits () takes
+ * to wake them all, and the cycles from the set to the last waiter running.
+ * It then measures the same wake latency for tasks that poll a shared flag
+ * with taskDelay (1), which is what the event group replaces. The results
+ * are in eventBenchResults, and eventBenchDone is set to 1 when they are
+ * complete. All times are DWT_CYCCNT cycles, the worst of BENCH_ROUNDS.
+ */
+
+#include "atomic.h"
+#include "config.h"
+#include "event_group.h"
+#include "task.h"
+
+#define MAX_WAITERS 32U
+#define BENCH_ROUNDS 16U
+#define SETTLE_MS 10U
+#define GO_BIT 0x1U
+
+#define MODE_EVENT_GROUP 0U
+#define MODE_POLLING 1U
+
+typedef struct
+{
+  uint32_t waiters;
+  uint32_t setBitsCycles;
+  uint32_t eventWakeCycles;
+  uint32_t pollWakeCycles;
+  uint32_t missedWakes;
+} EventBenchResult;
+
+uint32_t benchStack[STACK_SIZE];
+TCB benchTCB;
+TaskNode benchNode;
+uint32_t waiterStacks[MAX_WAITERS][STACK_SIZE];
+TCB waiterTCBs[MAX_WAITERS];
+TaskNode waiterNodes[MAX_WAITERS];
+
+volatile EventBenchResult eventBenchResults[3];
+volatile uint32_t eventBenchDone = 0;
+
+static EventGroup prvGroup;
+static volatile uint32_t prvNextWaiterIndex = 0;
+static volatile uint32_t prvActiveWaiters = 0;
+static volatile uint32_t prvMode = MODE_EVENT_GROUP;
+static volatile uint32_t prvPollRound = 0;
+static volatile uint32_t prvSetTime = 0;
+static volatile uint32_t prvWorstWake = 0;
+static volatile uint32_t prvWakes = 0;
+
+/**
+ * @brief This function will record the wake latency of the calling waiter.
+ */
+static void
+prvRecordWake ()
+{
+  uint32_t latency = DWT_CYCCNT - atomicLoad (&prvSetTime);
+  uint32_t worst;
+  do
+    {
+      worst = atomicLoad (&prvWorstWake);
+    }
+  while (latency > worst
+         && !atomicCompareAndSwap (&prvWorstWake, worst, latency));
+
+  atomicFetchAdd (&prvWakes, 1U);
+}
+
+static void
+waiterTask ()
+{
+  uint32_t index = atomicFetchAdd (&prvNextWaiterIndex, 1U);
+  uint32_t lastRound = atomicLoad (&prvPollRound);
+
+  while (1)
+    {
+      if (index >= atomicLoad (&prvActiveWaiters))
+        {
+          lastRound = atomicLoad (&prvPollRound);
+          taskDelay (1);
+        }
+      else if (atomicLoad (&prvMode) == MODE_EVENT_GROUP)
+        {
+          uint32_t bits = eventGroupWaitBits (&prvGroup, GO_BIT,
+                                              EVENT_CLEAR_ON_EXIT,
+                                              WAIT_FOREVER);
+          if ((bits & GO_BIT) && atomicLoad (&prvMode) == MODE_EVENT_GROUP)
+            {
+              prvRecordWake ();
+            }
+          lastRound = atomicLoad (&prvPollRound);
+        }
+      else
+        {
+          while (atomicLoad (&prvPollRound) == lastRound
+                 && atomicLoad (&prvMode) == MODE_POLLING)
+            {
+              taskDelay (1);
+            }
+          if (atomicLoad (&prvPollRound) != lastRound)
+            {
+              prvRecordWake ();
+              lastRound = atomicLoad (&prvPollRound);
+            }
+        }
+    }
+}
+
+/**
+ * @brief This function will clear the per-round counters.
+ */
+static void
+prvStartRound ()
+{
+  atomicStore (&prvWorstWake, 0);
+  atomicStore (&prvWakes, 0);
+  atomicStore (&prvSetTime, DWT_CYCCNT);
+}
+
+static void
+benchTask ()
+{
+  static const uint32_t waiterCounts[3] = { 1U, 8U, MAX_WAITERS };
+
+  DEMCR |= (1U << DEMCR_TRCENA_BIT);
+  DWT_CTRL |= (1U << DWT_CTRL_CYCCNTENA_BIT);
+
+  for (uint32_t n = 0; n < 3U; n++)
+    {
+      volatile EventBenchResult *result = &eventBenchResults[n];
+      result->waiters = waiterCounts[n];
+      result->setBitsCycles = 0;
+      result->eventWakeCycles = 0;
+      result->pollWakeCycles = 0;
+      result->missedWakes = 0;
+
+      atomicStore (&prvMode, MODE_EVENT_GROUP);
+      atomicStore (&prvActiveWaiters, waiterCounts[n]);
+      taskDelay (SETTLE_MS);
+
+      for (uint32_t round = 0; round < BENCH_ROUNDS; round++)
+        {
+          prvStartRound ();
+          eventGroupSetBits (&prvGroup, GO_BIT);
+          uint32_t cycles = DWT_CYCCNT - prvSetTime;
+          taskDelay (SETTLE_MS);
+
+          if (cycles > result->setBitsCycles)
+            result->setBitsCycles = cycles;
+          if (prvWorstWake > result->eventWakeCycles)
+            result->eventWakeCycles = prvWorstWake;
+          result->missedWakes += waiterCounts[n] - prvWakes;
+        }
+
+      /* Release the waiters still blocked on the group into polling */
+      atomicStore (&prvMode, MODE_POLLING);
+      eventGroupSetBits (&prvGroup, GO_BIT);
+      taskDelay (SETTLE_MS);
+      eventGroupClearBits (&prvGroup, GO_BIT);
+
+      for (uint32_t round = 0; round < BENCH_ROUNDS; round++)
+        {
+          prvStartRound ();
+          atomicFetchAdd (&prvPollRound, 1U);
+          taskDelay (SETTLE_MS);
+
+          if (prvWorstWake > result->pollWakeCycles)
+            result->pollWakeCycles = prvWorstWake;
+          result->missedWakes += waiterCounts[n] - prvWakes;
+        }
+    }
+
+  atomicStore (&prvActiveWaiters, 0);
+  eventBenchDone = 1;
+
+  while (1)
+    {
+      taskDelay (1000);
+    }
+}
+
+int
+main (void)
+{
+  configureAll ();
+  createEventGroup (&prvGroup);
+
+  createTask (benchStack, &benchTask, 1, &benchTCB, &benchNode);
+  for (uint32_t i = 0; i < MAX_WAITERS; i++)
+    {
+      createTask (waiterStacks[i], &waiterTask, 1, &waiterTCBs[i],
+                  &waiterNodes[i]);
+    }
+
+  startScheduler ();
+  while (1)
+    {
+    }
+}
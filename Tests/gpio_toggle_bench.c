@@ -0,0 +1,67 @@
+/**
+ * @file    gpio_toggle_bench.c
+ * @brief   On-target cycle comparison of GPIO output methods.
+ * @details
+ * Build it in place of the application's main file. It toggles PD14 (red
+ * LED) TOGGLE_COUNT times with each method before the scheduler starts,
+ * with interrupts off, and stores the average cycles per toggle in
+ * gpioBenchResults:
+ * - [0] GPIOD_ODR ^= mask, the read-modify-write the examples used to do
+ * - [1] GPIO_TOGGLE (D, 14)
+ * - [2] GPIO_SET (D, 14) and GPIO_RESET (D, 14) in turn
+ * gpioBenchDone is set to 1 when they are complete. The same pin can be
+ * watched with a logic analyzer as in the toggle-time method of
+ * Tests/README.md, where each burst shows up as a square wave whose
+ * half-period is the cost of one toggle.
+ */
+
+#include "config.h"
+#include "gpio.h"
+#include "system_funcs.h"
+
+#define TOGGLE_COUNT 1000U
+#define BENCH_PIN 14
+
+volatile uint32_t gpioBenchResults[3];
+volatile uint32_t gpioBenchDone = 0;
+
+int
+main (void)
+{
+  configureAll ();
+  GPIO_SET_MODE (D, BENCH_PIN, GPIO_MODE_OUTPUT);
+
+  DEMCR |= (1U << DEMCR_TRCENA_BIT);
+  DWT_CTRL |= (1U << DWT_CTRL_CYCCNTENA_BIT);
+
+  uint32_t savedPRIMASK = systemENTER_CRITICAL_FROM_ISR ();
+  {
+    uint32_t start = DWT_CYCCNT;
+    for (uint32_t i = 0; i < TOGGLE_COUNT; i++)
+      {
+        GPIOD_ODR ^= (1U << BENCH_PIN);
+      }
+    gpioBenchResults[0] = (DWT_CYCCNT - start) / TOGGLE_COUNT;
+
+    start = DWT_CYCCNT;
+    for (uint32_t i = 0; i < TOGGLE_COUNT; i++)
+      {
+        GPIO_TOGGLE (D, BENCH_PIN);
+      }
+    gpioBenchResults[1] = (DWT_CYCCNT - start) / TOGGLE_COUNT;
+
+    start = DWT_CYCCNT;
+    for (uint32_t i = 0; i < TOGGLE_COUNT / 2U; i++)
+      {
+        GPIO_SET (D, BENCH_PIN);
+        GPIO_RESET (D, BENCH_PIN);
+      }
+    gpioBenchResults[2] = (DWT_CYCCNT - start) / TOGGLE_COUNT;
+  }
+  systemEXIT_CRITICAL_FROM_ISR (savedPRIMASK);
+
+  gpioBenchDone = 1;
+  while (1)
+    {
+    }
+}
@@ -0,0 +1,151 @@
+/**
+ * @file    ram_exec_bench.c
+ * @brief   On-target tick and context switch cost, to compare USE_RAM_EXECUTION against flash execution.
+ * @details
+ * Build it in place of the application's main file, once with `make` and
+ * once with `make RAM_EXEC=1`, and compare ramBenchResults between the two.
+ * A task spins reading DWT_CYCCNT, and the longest gap between two reads is
+ * the time an interrupt took from it:
+ * - tickCycles: one task spins alone, so every tick returns to it without
+ *   a switch. The gap is SysTick_Handler with its exception entry and exit.
+ * - switchCycles: two tasks of equal priority spin and round-robin on every
+ *   tick. The gap from the last read of one task to the first read of the
+ *   other is the tick plus PendSV_Handler.
+ * loopCycles is the shortest gap, the cost of the loop itself, which is
+ * included in the other two. ramBenchDone is set to 1 when the results are
+ * complete.
+ */
+
+#include "atomic.h"
+#include "config.h"
+#include "task.h"
+
+#define SPIN_MS 1000U
+/* Switches seen before the gaps are recorded, so the first switch out of
+   taskDelay () is left out */
+#define WARMUP_SWITCHES 4U
+
+/* The second task joins at this tick, after the tick was measured */
+#define SWITCH_START_MS (2U * SPIN_MS)
+
+typedef struct
+{
+  uint32_t ramExecution;
+  uint32_t loopCycles;
+  uint32_t tickCycles;
+  uint32_t switchCycles;
+} RamBenchResult;
+
+uint32_t task1Stack[STACK_SIZE];
+uint32_t task2Stack[STACK_SIZE];
+TCB task1TCB;
+TCB task2TCB;
+TaskNode task1Node;
+TaskNode task2Node;
+
+volatile RamBenchResult ramBenchResults;
+volatile uint32_t ramBenchDone = 0;
+
+static volatile uint32_t prvNextTaskIndex = 0;
+static volatile uint32_t prvLastOwner = 0;
+static volatile uint32_t prvLastTime = 0;
+static volatile uint32_t prvSwitches = 0;
+
+/**
+ * @brief This function will spin alone for SPIN_MS and record the shortest and longest gap between two reads of DWT_CYCCNT.
+ */
+static void
+prvMeasureTick ()
+{
+  uint32_t shortest = UINT32_MAX;
+  uint32_t longest = 0;
+  uint64_t end = getTickCount () + SPIN_MS;
+  uint32_t last = DWT_CYCCNT;
+
+  while (getTickCount () < end)
+    {
+      uint32_t now = DWT_CYCCNT;
+      uint32_t gap = now - last;
+      last = now;
+
+      if (gap < shortest)
+        shortest = gap;
+      if (gap > longest)
+        longest = gap;
+    }
+
+  ramBenchResults.loopCycles = shortest;
+  ramBenchResults.tickCycles = longest;
+}
+
+/**
+ * @brief This function will spin against the other task for SPIN_MS and record the longest gap across a switch.
+ */
+static void
+prvMeasureSwitch (uint32_t owner, uint64_t end)
+{
+  while (getTickCount () < end)
+    {
+      uint32_t now = DWT_CYCCNT;
+
+      if (prvLastOwner != owner)
+        {
+          uint32_t switches = atomicFetchAdd (&prvSwitches, 1U);
+          uint32_t gap = now - prvLastTime;
+          if (switches >= WARMUP_SWITCHES
+              && gap > ramBenchResults.switchCycles)
+            {
+              ramBenchResults.switchCycles = gap;
+            }
+          prvLastOwner = owner;
+        }
+      prvLastTime = DWT_CYCCNT;
+    }
+}
+
+static void
+benchTask ()
+{
+  uint32_t index = atomicFetchAdd (&prvNextTaskIndex, 1U);
+
+  if (index == 0)
+    {
+      DEMCR |= (1U << DEMCR_TRCENA_BIT);
+      DWT_CTRL |= (1U << DWT_CTRL_CYCCNTENA_BIT);
+
+      ramBenchResults.ramExecution = USE_RAM_EXECUTION;
+      ramBenchResults.switchCycles = 0;
+      prvMeasureTick ();
+    }
+  else
+    {
+      /* Stay blocked until the first task has measured the tick alone */
+      taskDelay (SWITCH_START_MS);
+    }
+
+  prvMeasureSwitch (index + 1U, SWITCH_START_MS + SPIN_MS);
+
+  if (index == 0)
+    {
+      ramBenchDone = 1;
+    }
+
+  while (1)
+    {
+      taskDelay (1000);
+    }
+}
+
+int
+main (void)
+{
+  configureAll ();
+
+  createTask (task1Stack, &benchTask, 1, &task1TCB, &task1Node);
+  createTask (task2Stack, &benchTask, 1, &task2TCB, &task2Node);
+
+  startScheduler ();
+  while (1)
+    {
+    }
+}
@@ -0,0 +1,26 @@
+/**
+ * @file    task_define_test.c
+ * @brief   Compile test of TASK_DEFINE at the smallest allowed stack size.
+ * @details
+ * Defines tasks with exactly MIN_STACK_SIZE and MIN_STACK_SIZE + 1 words of
+ * stack with the target compiler. It only needs to compile, check it with
+ * `make task-define-test`.
+ */
+
+#include "task.h"
+
+static void
+prvMinimumTask ()
+{
+  for (;;)
+    {
+    }
+}
+
+TASK_DEFINE (minimumTask, prvMinimumTask, 0, MIN_STACK_SIZE);
+TASK_DEFINE (nextTask, prvMinimumTask, 0, MIN_STACK_SIZE + 1U);
+
+_Static_assert (sizeof (minimumTaskStack) == MIN_STACK_SIZE * 4U,
+                "minimumTask must get exactly MIN_STACK_SIZE words");
+_Static_assert (sizeof (nextTaskStack) == (MIN_STACK_SIZE + 1U) * 4U,
+                "nextTask must get exactly MIN_STACK_SIZE + 1 words");
@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""
+Print the worst critical sections and the duration histogram from a dump of the SRTOS critical section profile.
+
+The dump is a raw binary image of `criticalProfile` (sizeof (CriticalProfile)
+bytes starting at &criticalProfile), for example from gdb:
+
+    dump binary memory profile.bin &criticalProfile ((char *)&criticalProfile) + sizeof (criticalProfile)
+
+Usage:
+
+    python3 Tools/critical_profile_decode.py profile.bin --elf build/main.elf --cpu-hz 8000000
+
+With --elf, every call site is resolved to a function and source line with
+addr2line. The layout must match `CriticalProfile` and `CriticalSiteRecord` in
+`Inc/critical_profile.h`.
+"""
+
+import argparse
+import struct
+import subprocess
+import sys
+
+CRITICAL_PROFILE_MAGIC = 0x43525450
+HEADER_FORMAT = "<4I"
+SITE_FORMAT = "<3I"
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+SITE_SIZE = struct.calcsize(SITE_FORMAT)
+
+
+def parse_profile(data):
+    """Return the number of sections, the histogram and the used call site records."""
+    magic, top_sites, bins, sections = struct.unpack_from(HEADER_FORMAT, data, 0)
+    if magic != CRITICAL_PROFILE_MAGIC:
+        raise ValueError("bad magic 0x%08X, is this a dump of criticalProfile?" % magic)
+    if HEADER_SIZE + bins * 4 + top_sites * SITE_SIZE > len(data):
+        raise ValueError("dump is shorter than the profile it describes")
+
+    histogram = list(struct.unpack_from("<%dI" % bins, data, HEADER_SIZE))
+    sites = []
+    offset = HEADER_SIZE + bins * 4
+    for _ in range(top_sites):
+        call_site, worst, count = struct.unpack_from(SITE_FORMAT, data, offset)
+        offset += SITE_SIZE
+        if call_site:
+            sites.append((call_site, worst, count))
+    sites.sort(key=lambda site: site[1], reverse=True)
+    return sections, histogram, sites
+
+
+def resolve(addresses, elf, addr2line):
+    """Map each return address to 'function at file:line' of the call before it."""
+    if not elf or not addresses:
+        return {}
+    # The recorded address is the return address, step back into the call
+    query = ["0x%x" % (address - 1) for address in addresses]
+    output = subprocess.run([addr2line, "-f", "-s", "-e", elf] + query,
+                            check=True, capture_output=True, text=True).stdout
+    lines = output.splitlines()
+    return {address: "%s at %s" % (lines[2 * i], lines[2 * i + 1])
+            for i, address in enumerate(addresses)}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("dump", help="binary dump of criticalProfile")
+    parser.add_argument("--elf", help="firmware ELF used to resolve call sites")
+    parser.add_argument("--addr2line", default="arm-none-eabi-addr2line")
+    parser.add_argument("--cpu-hz", type=float, default=8e6,
+                        help="core clock used for CYCCNT (default: 8 MHz HSE)")
+    args = parser.parse_args()
+
+    with open(args.dump, "rb") as dump:
+        data = dump.read()
+
+    try:
+        sections, histogram, sites = parse_profile(data)
+    except ValueError as error:
+        print("error: %s" % error, file=sys.stderr)
+        return 1
+
+    def us(cycles):
+        return cycles * 1e6 / args.cpu_hz
+
+    names = resolve([site[0] for site in sites], args.elf, args.addr2line)
+
+    print("%d critical sections measured" % sections)
+    print()
+    print("Worst call sites:")
+    print("  %-10s %12s %10s %10s  %s" % ("address", "worst cyc", "worst us", "count", "location"))
+    for call_site, worst, count in sites:
+        print("  0x%08X %12d %10.2f %10d  %s" % (call_site, worst, us(worst), count,
+                                                 names.get(call_site, "")))
+
+    print()
+    print("Duration histogram:")
+    peak = max(histogram) if histogram else 0
+    for index, count in enumerate(histogram):
+        low = 0 if index == 0 else 1 << index
+        if index == len(histogram) - 1:
+            label = ">= %d" % low
+        else:
+            label = "%d-%d" % (low, (1 << (index + 1)) - 1)
+        bar = "#" * (round(40 * count / peak) if peak else 0)
+        print("  %16s cyc %10d  %s" % (label, count, bar))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+"""
+Decode a dump of the SRTOS FAULT_DATA flash sector into readable fault reports.
+
+The dump is a raw binary image of the sector starting at
+FAULT_DATA_FLASH_START_ADDR (0x08060000), for example:
+
+    STM32_Programmer_CLI -c port=SWD -u 0x08060000 0x20000 fault_data.bin
+
+Usage:
+
+    python3 Tools/fault_decode.py fault_data.bin
+
+The record layout must match `FaultRecord` in `Inc/fault.h`.
+"""
+
+import argparse
+import struct
+import sys
+
+FAULT_RECORD_MAGIC = 0x5AFE7D0C
+FAULT_NO_TASK_ID = 0xFFFFFFFF
+FLASH_ERASED_WORD = 0xFFFFFFFF
+
+RECORD_FIELDS = (
+    ["magic"]
+    + ["r%d" % i for i in range(13)]
+    + ["sp", "lr", "pc", "xpsr", "cfsr", "hfsr", "mmfar", "bfar",
+       "msTicksLow", "msTicksHigh", "taskID", "sequence"]
+)
+RECORD_FORMAT = "<%dI" % len(RECORD_FIELDS)
+RECORD_SIZE = struct.calcsize(RECORD_FORMAT)
+
+CFSR_BITS = {
+    0: "IACCVIOL: instruction access violation",
+    1: "DACCVIOL: data access violation",
+    3: "MUNSTKERR: MemManage fault on exception return unstacking",
+    4: "MSTKERR: MemManage fault on exception entry stacking",
+    5: "MLSPERR: MemManage fault during lazy FP state preservation",
+    7: "MMARVALID: MMFAR holds a valid fault address",
+    8: "IBUSERR: instruction bus error",
+    9: "PRECISERR: precise data bus error",
+    10: "IMPRECISERR: imprecise data bus error",
+    11: "UNSTKERR: BusFault on exception return unstacking",
+    12: "STKERR: BusFault on exception entry stacking",
+    13: "LSPERR: BusFault during lazy FP state preservation",
+    15: "BFARVALID: BFAR holds a valid fault address",
+    16: "UNDEFINSTR: undefined instruction",
+    17: "INVSTATE: invalid EPSR state (Thumb bit clear)",
+    18: "INVPC: invalid EXC_RETURN load to PC",
+    19: "NOCP: coprocessor access while disabled",
+    24: "UNALIGNED: unaligned access",
+    25: "DIVBYZERO: divide by zero",
+}
+
+HFSR_BITS = {
+    1: "VECTTBL: BusFault on vector table read",
+    30: "FORCED: configurable fault escalated to HardFault",
+    31: "DEBUGEVT: debug event",
+}
+
+
+def decode_bits(value, table):
+    return [text for bit, text in sorted(table.items()) if value & (1 << bit)]
+
+
+def parse_records(data):
+    """Return (complete records, slots of torn records).
+
+    The magic word is programmed last, so a slot with an erased magic but
+    other programmed words was torn by a reset while it was written.
+    """
+    records = []
+    torn = []
+    for offset in range(0, len(data) - RECORD_SIZE + 1, RECORD_SIZE):
+        words = struct.unpack_from(RECORD_FORMAT, data, offset)
+        record = dict(zip(RECORD_FIELDS, words))
+        slot = offset // RECORD_SIZE
+        if record["magic"] == FLASH_ERASED_WORD:
+            if all(word == FLASH_ERASED_WORD for word in words):
+                break
+            torn.append(slot)
+            continue
+        record["slot"] = slot
+        records.append(record)
+    return records, torn
+
+
+def format_record(record):
+    lines = []
+    ticks = (record["msTicksHigh"] << 32) | record["msTicksLow"]
+    task = ("none (before scheduler start)"
+            if record["taskID"] == FAULT_NO_TASK_ID else str(record["taskID"]))
+
+    lines.append("=== Fault record %d (sequence %d) ===" % (record["slot"], record["sequence"]))
+    if record["magic"] != FAULT_RECORD_MAGIC:
+        lines.append("WARNING: bad magic 0x%08X, record may be corrupt"
+                     % record["magic"])
+    lines.append("msTicks : %d" % ticks)
+    lines.append("task id : %s" % task)
+    lines.append("pc      : 0x%08X" % record["pc"])
+    lines.append("lr      : 0x%08X" % record["lr"])
+    lines.append("sp      : 0x%08X" % record["sp"])
+    lines.append("xpsr    : 0x%08X" % record["xpsr"])
+    for i in range(0, 13, 4):
+        regs = ["r%-2d: 0x%08X" % (j, record["r%d" % j])
+                for j in range(i, min(i + 4, 13))]
+        lines.append("  ".join(regs))
+    lines.append("CFSR    : 0x%08X" % record["cfsr"])
+    for text in decode_bits(record["cfsr"], CFSR_BITS):
+        lines.append("  - " + text)
+    lines.append("HFSR    : 0x%08X" % record["hfsr"])
+    for text in decode_bits(record["hfsr"], HFSR_BITS):
+        lines.append("  - " + text)
+    if record["cfsr"] & (1 << 7):
+        lines.append("MMFAR   : 0x%08X" % record["mmfar"])
+    if record["cfsr"] & (1 << 15):
+        lines.append("BFAR    : 0x%08X" % record["bfar"])
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("dump", help="binary dump of the FAULT_DATA sector")
+    args = parser.parse_args()
+
+    with open(args.dump, "rb") as dump:
+        data = dump.read()
+
+    records, torn = parse_records(data)
+    for slot in torn:
+        print("Slot %d holds a record torn by a reset, it was skipped." % slot)
+    if not records:
+        print("No fault records found.")
+        return 0
+
+    print("%d fault record(s) found, oldest first." % len(records))
+    if records[0]["sequence"] > 0:
+        print("%d earlier record(s) were erased when the log filled up." % records[0]["sequence"])
+    print()
+    for record in records:
+        print(format_record(record))
+        print()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,273 @@
+#!/usr/bin/env python3
+"""
+Compute the worst-case response time and slack of every SRTOS task offline.
+
+The task set is a JSON file:
+
+    {
+      "cpu_hz": 8000000,
+      "tick_cycles": 400,
+      "pendsv_cycles": 150,
+      "blocking_cycles": 0,
+      "tasks": [
+        {"name": "task1_control", "period": 10, "deadline": 8,
+         "priority": 1, "wcet_us": 900, "id": 0},
+        ...
+      ]
+    }
+
+`period` and `deadline` are in SysTick ticks (ms), the unit of
+`taskDelayUntil ()` and `setTaskDeadline ()`. `deadline` defaults to the
+period. The WCET of a task is given as `wcet_cycles` or `wcet_us`, or
+measured from a trace dump with `--trace` for tasks that give their trace
+`id`. `priority` can be left out and read from the `createTask ()` and
+`TASK_DEFINE ()` calls in `--src`, matched by the task function `name`.
+`preemption_threshold` defaults to the priority.
+`observed_response_ms`, for example `worstResponseTime` of the task's
+`DeadlineMonitor`, is printed next to the bound as a sanity check.
+
+`tick_cycles` and `pendsv_cycles` are the measured costs of
+`SysTick_Handler ()` and `PendSV_Handler ()`. `blocking_cycles` is the
+longest critical section, or it is taken from a `criticalProfile` dump with
+`--critical-profile`.
+
+Usage:
+
+    python3 Tools/response_time_analysis.py tasks.json --src . --trace trace.bin
+
+The analysis follows the scheduler in `task.c`:
+- tasks are released on tick boundaries, so periods are whole ticks and a
+  higher priority release preempts at the tick it happens on
+- every tick runs `SysTick_Handler ()`, whether it switches or not
+- a job costs two `PendSV_Handler ()` switches, one in and one out
+- tasks of equal priority round-robin every tick, so they interfere like
+  higher priority tasks and add one switch per tick while they share it
+- a critical section of a lower priority task can hold off the tick once
+- a lower priority task whose preemption threshold is at or above a task's
+  priority can block it once for its whole WCET, and a task running above
+  its priority is not time sliced
+
+Exits with status 1 if a task can miss its deadline.
+"""
+
+import argparse
+import glob
+import json
+import math
+import os
+import re
+import sys
+
+from critical_profile_decode import parse_profile
+from trace_to_perfetto import (EVENT_TASK_DELAY, EVENT_TASK_SWITCH_IN,
+                               parse_buffer)
+
+TICK_HZ = 1000
+
+PRIORITY_PATTERNS = [
+    re.compile(r"\bcreateTask\s*\(\s*[^,]+,\s*&?\s*(\w+)\s*,\s*(\w+)"),
+    re.compile(r"\bTASK_DEFINE\s*\(\s*\w+\s*,\s*&?\s*(\w+)\s*,\s*(\w+)"),
+]
+
+
+def read_priorities(src_dir):
+    """Return {task function: priority} from the createTask () and TASK_DEFINE () calls in src_dir."""
+    priorities = {}
+    paths = glob.glob(os.path.join(src_dir, "**", "*.c"), recursive=True)
+    for path in paths:
+        with open(path) as source:
+            text = source.read()
+        for pattern in PRIORITY_PATTERNS:
+            for func, priority in pattern.findall(text):
+                if priority.isdigit():
+                    priorities[func] = int(priority)
+    return priorities
+
+
+def measure_wcet(records):
+    """Return {task id: longest execution of one job in cycles} from trace records.
+
+    A job runs from the task's first switch-in after it last delayed until its
+    next TASK_DELAY event. Time spent in interrupts is included.
+    """
+    wcet = {}
+    job = {}
+    running = None
+    since = 0
+    for cycles, event, _priority, task_id in records:
+        if event == EVENT_TASK_SWITCH_IN:
+            if running is not None:
+                job[running] = job.get(running, 0) + cycles - since
+            running = task_id
+            since = cycles
+        elif event == EVENT_TASK_DELAY and task_id == running:
+            spent = job.pop(running, 0) + cycles - since
+            wcet[running] = max(wcet.get(running, 0), spent)
+            running = None
+    return wcet
+
+
+def response_time(task, tasks, params):
+    """Return the worst-case response time of task in cycles, or None if it exceeds the deadline."""
+    tick = params["cpu_hz"] / TICK_HZ
+    switch = params["pendsv_cycles"]
+    interferers = [other for other in tasks
+                   if other is not task and other["priority"] >= task["priority"]]
+    shares_level = (task["threshold"] == task["priority"]
+                    and any(other["priority"] == task["priority"] for other in interferers))
+    deadline = task["deadline"] * tick
+
+    blocking = params["blocking_cycles"]
+    for other in tasks:
+        if other["priority"] < task["priority"] <= other["threshold"]:
+            blocking = max(blocking, other["wcet"] + 2 * switch)
+
+    own = task["wcet"] + 2 * switch + blocking
+    response = own
+    while True:
+        ticks = math.ceil(response / tick)
+        demand = own + ticks * params["tick_cycles"]
+        if shares_level:
+            demand += ticks * switch
+        for other in interferers:
+            demand += math.ceil(response / (other["period"] * tick)) * (other["wcet"] + 2 * switch)
+        if demand > deadline:
+            return None
+        if demand == response:
+            return response
+        response = demand
+
+
+def analyse(tasks, params):
+    """Return {task name: response time in cycles or None}."""
+    return {task["name"]: response_time(task, tasks, params) for task in tasks}
+
+
+def scaling_factor(tasks, params):
+    """Return how much every WCET could be multiplied by with all deadlines still met."""
+    def fits(factor):
+        scaled = [dict(task, wcet=task["wcet"] * factor) for task in tasks]
+        return all(response is not None for response in analyse(scaled, params).values())
+
+    if not fits(1.0):
+        return None
+    low, high = 1.0, 2.0
+    while fits(high) and high < 1e6:
+        low, high = high, high * 2
+    for _ in range(40):
+        middle = (low + high) / 2
+        if fits(middle):
+            low = middle
+        else:
+            high = middle
+    return low
+
+
+def load_task_set(args):
+    with open(args.tasks) as description:
+        task_set = json.load(description)
+
+    params = {
+        "cpu_hz": float(task_set.get("cpu_hz", args.cpu_hz)),
+        "tick_cycles": float(task_set.get("tick_cycles", 0)),
+        "pendsv_cycles": float(task_set.get("pendsv_cycles", 0)),
+        "blocking_cycles": float(task_set.get("blocking_cycles", 0)),
+    }
+
+    if args.critical_profile:
+        with open(args.critical_profile, "rb") as dump:
+            _sections, _histogram, sites = parse_profile(dump.read())
+        if sites:
+            params["blocking_cycles"] = float(max(site[1] for site in sites))
+
+    measured = {}
+    if args.trace:
+        with open(args.trace, "rb") as dump:
+            records, _dropped = parse_buffer(dump.read())
+        measured = measure_wcet(records)
+
+    priorities = read_priorities(args.src) if args.src else {}
+
+    tasks = []
+    for entry in task_set["tasks"]:
+        task = {"name": entry["name"], "period": int(entry["period"])}
+        task["deadline"] = int(entry.get("deadline", task["period"]))
+        task["observed"] = entry.get("observed_response_ms")
+
+        if "priority" in entry:
+            task["priority"] = int(entry["priority"])
+        elif task["name"] in priorities:
+            task["priority"] = priorities[task["name"]]
+        else:
+            raise ValueError("no priority for %s, add it or pass --src" % task["name"])
+        task["threshold"] = int(entry.get("preemption_threshold", task["priority"]))
+        if task["threshold"] < task["priority"]:
+            raise ValueError("%s: preemption_threshold is below its priority" % task["name"])
+
+        if "wcet_cycles" in entry:
+            task["wcet"] = float(entry["wcet_cycles"])
+        elif "wcet_us" in entry:
+            task["wcet"] = float(entry["wcet_us"]) * params["cpu_hz"] / 1e6
+        elif "id" in entry and entry["id"] in measured:
+            task["wcet"] = float(measured[entry["id"]])
+        else:
+            raise ValueError("no WCET for %s, add it or pass --trace with its id" % task["name"])
+
+        if task["period"] < 1 or task["deadline"] < 1:
+            raise ValueError("%s: period and deadline must be at least 1 tick" % task["name"])
+        tasks.append(task)
+
+    return tasks, params
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("tasks", help="JSON task set description")
+    parser.add_argument("--src", help="directory to read createTask () priorities from")
+    parser.add_argument("--trace", help="binary dump of traceBuffer to measure WCETs from")
+    parser.add_argument("--critical-profile",
+                        help="binary dump of criticalProfile to take the blocking time from")
+    parser.add_argument("--cpu-hz", type=float, default=8e6,
+                        help="core clock if the task set does not give cpu_hz (default: 8 MHz HSE)")
+    args = parser.parse_args()
+
+    try:
+        tasks, params = load_task_set(args)
+    except (ValueError, KeyError) as error:
+        print("error: %s" % error, file=sys.stderr)
+        return 1
+
+    def ms(cycles):
+        return cycles * 1e3 / params["cpu_hz"]
+
+    responses = analyse(tasks, params)
+    utilization = sum(task["wcet"] / (task["period"] * params["cpu_hz"] / TICK_HZ)
+                      for task in tasks)
+
+    print("%-24s %4s %7s %9s %10s %10s %10s %10s" % (
+        "task", "prio", "period", "deadline", "wcet ms", "bound ms", "slack ms", "observed"))
+    schedulable = True
+    for task in sorted(tasks, key=lambda task: -task["priority"]):
+        response = responses[task["name"]]
+        observed = "" if task["observed"] is None else "%.3f" % task["observed"]
+        if response is None:
+            schedulable = False
+            bound, slack = "MISS", "-"
+        else:
+            bound = "%.3f" % ms(response)
+            slack = "%.3f" % (task["deadline"] - ms(response))
+        print("%-24s %4d %7d %9d %10.3f %10s %10s %10s" % (
+            task["name"], task["priority"], task["period"], task["deadline"],
+            ms(task["wcet"]), bound, slack, observed))
+
+    print()
+    print("CPU utilization by tasks: %.1f%%" % (100 * utilization))
+    print("SysTick overhead:         %.1f%%" % (100 * params["tick_cycles"] * TICK_HZ / params["cpu_hz"]))
+    factor = scaling_factor(tasks, params)
+    if factor is not None:
+        print("All WCETs can grow by a factor of %.2f before a deadline is missed" % factor)
+    return 0 if schedulable else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,362 @@
+#!/usr/bin/env python3
+"""
+Compute the worst-case stack depth of every SRTOS task at build time.
+
+Combines the per-function frame sizes that GCC writes to `.su` files
+(`-fstack-usage`) with a call graph taken from the disassembly of the linked
+ELF. Unlinked object files also work, as their calls are read from the
+relocations that `objdump -dr` prints. Every task entry function passed to `createTask ()`, `TASK_DEFINE ()`
+or `initTaskStackFrame ()` is a root. Functions passed to `createJob ()` and
+`workQueuePostFromISR ()` are treated as callees of the job dispatcher and
+the work queue worker, which call them through a function pointer.
+
+The worst-case depth of a task is its deepest call chain, plus the exception
+frame the core stacks on the task's stack when it is interrupted, plus the
+r4-r11 save area of `PendSV_Handler`, plus the reserved words: the 2 canaries,
+or the up to 15 words of the MPU guard with `USE_MPU_STACK_GUARD`.
+
+Each task is checked against its own stack: the `stackWords` argument of its
+`TASK_DEFINE ()`, evaluated with the `#define`s found in `--src`, or
+STACK_SIZE for tasks made with `createTask ()`, which always uses STACK_SIZE.
+Calls through the linker's `__<name>_veneer` stubs, for example into
+`.RamFunc`, are followed to `<name>`.
+
+Usage (from the directory holding the Makefile):
+
+    python3 Tools/stack_analyzer.py --src . build/main.elf
+
+Exits with status 1 if a task needs more words than its stack has, or if the
+depth can not be bounded (recursion). `--emit-header FILE` writes a header of
+right-sized `<TASK>_STACK_WORDS` constants.
+"""
+
+import argparse
+import glob
+import math
+import os
+import re
+import subprocess
+import sys
+
+BASIC_EXCEPTION_FRAME_BYTES = 8 * 4
+FPU_EXCEPTION_FRAME_BYTES = 26 * 4
+CALLEE_SAVED_BYTES = 8 * 4
+
+ROOT_PATTERNS = [
+    re.compile(r"\bcreateTask\s*\(\s*[^,]+,\s*&?\s*(\w+)"),
+    re.compile(r"\bTASK_DEFINE\s*\(\s*\w+\s*,\s*&?\s*(\w+)"),
+    re.compile(r"\binitTaskStackFrame\s*\(\s*[^,]+,\s*&?\s*(\w+)"),
+]
+TASK_DEFINE_SIZE_RE = re.compile(
+    r"\bTASK_DEFINE\s*\(\s*\w+\s*,\s*&?\s*(\w+)\s*,[^,]+,\s*([^)]+?)\s*\)")
+DEFINE_RE = re.compile(r"^\s*#\s*define\s+(\w+)\s+(.+?)\s*(?:/\*.*)?$", re.MULTILINE)
+DIRECTIVE_RE = re.compile(r"^\s*#\s*(if|ifdef|ifndef|else|endif)\b(.*)$")
+IDENTIFIER_RE = re.compile(r"\b[A-Za-z_]\w*\b")
+MPU_GUARD_RESERVED_WORDS = 15
+CANARY_RESERVED_WORDS = 2
+DEFERRED_PATTERNS = [
+    (re.compile(r"\bcreateJob\s*\(\s*[^,]+,\s*&?\s*(\w+)"),
+     "prvJobDispatcherTask"),
+    (re.compile(r"\bworkQueuePostFromISR\s*\(\s*&?\s*(\w+)"),
+     "prvWorkQueueTask"),
+]
+
+FUNC_RE = re.compile(r"^[0-9a-fA-F]+ <([^>]+)>:$")
+# Tail calls can be conditional branches, for example "beq.w <callee>".
+CALL_RE = re.compile(
+    r"\s(bl|blx|b(?:eq|ne|cs|hs|cc|lo|mi|pl|vs|vc|hi|ls|ge|lt|gt|le|al)?(?:\.w|\.n)?|call|jmp)"
+    r"\s+[0-9a-fA-F]+ <([^>+]+)>")
+VENEER_RE = re.compile(r"^__(\w+?)_veneer$")
+INDIRECT_RE = re.compile(r"\s(blx|call)\s+(r\d+|lr|ip|\*)")
+# In an unlinked object a call disassembles as "<self+0x..>", the real callee
+# is named by the relocation printed on the following line.
+CALL_RELOC_RE = re.compile(
+    r"^\s*[0-9a-fA-F]+:\s+(R_ARM_THM_CALL|R_ARM_THM_JUMP24|R_ARM_CALL|R_ARM_JUMP24"
+    r"|R_X86_64_PLT32|R_X86_64_PC32|R_386_PLT32|R_386_PC32)\s+([^\s+-]+)")
+
+
+def strip_clone_suffix(name):
+    return name.split(".")[0]
+
+
+def resolve_veneer(name):
+    """Return the function a linker veneer jumps to, or name itself."""
+    match = VENEER_RE.match(name)
+    return match.group(1) if match else name
+
+
+def read_stack_usage(paths):
+    """Return {function: frame bytes} from .su files."""
+    frames = {}
+    dynamic = set()
+    for path in paths:
+        with open(path) as su:
+            for line in su:
+                fields = line.rstrip("\n").split("\t")
+                if len(fields) < 3:
+                    continue
+                name = strip_clone_suffix(fields[0].rsplit(":", 1)[-1])
+                frames[name] = max(frames.get(name, 0), int(fields[1]))
+                if "dynamic" in fields[2] and "bounded" not in fields[2]:
+                    dynamic.add(name)
+    return frames, dynamic
+
+
+def read_call_graph(objdump, binaries):
+    """Return {function: set of callees} and the set of functions with indirect calls."""
+    graph = {}
+    indirect = set()
+    output = subprocess.run([objdump, "-dr", "--no-show-raw-insn"] + binaries,
+                            check=True, capture_output=True, text=True).stdout
+    current = None
+    for line in output.splitlines():
+        match = FUNC_RE.match(line.strip())
+        if match:
+            current = resolve_veneer(strip_clone_suffix(match.group(1)))
+            graph.setdefault(current, set())
+            continue
+        if current is None:
+            continue
+        match = CALL_RELOC_RE.match(line) or CALL_RE.search(line)
+        if match:
+            callee = resolve_veneer(strip_clone_suffix(match.group(2)))
+            if callee != current and not callee.startswith("."):
+                graph[current].add(callee)
+            continue
+        if INDIRECT_RE.search(line):
+            indirect.add(current)
+    return graph, indirect
+
+
+def find_roots(sources):
+    roots = []
+    deferred = {}
+    for path in sources:
+        with open(path, errors="replace") as src:
+            text = src.read()
+        for pattern in ROOT_PATTERNS:
+            for name in pattern.findall(text):
+                if name not in roots:
+                    roots.append(name)
+        for pattern, caller in DEFERRED_PATTERNS:
+            for name in pattern.findall(text):
+                deferred.setdefault(caller, set()).add(name)
+    return roots, deferred
+
+
+def read_defines(src_dirs):
+    """Return {macro: [definitions]} from every .h and .c file in src_dirs.
+
+    A first pass collects every definition. A second pass keeps only the
+    definitions in the taken branch of #if, #ifdef, #ifndef and #else
+    blocks whose condition the first pass can evaluate.
+    """
+    paths = []
+    for src_dir in src_dirs:
+        for pattern in ("*.h", "*.c"):
+            paths += glob.glob(os.path.join(src_dir, "**", pattern), recursive=True)
+    texts = []
+    for path in paths:
+        with open(path, errors="replace") as source:
+            texts.append(source.read())
+
+    every = {}
+    for text in texts:
+        for name, value in DEFINE_RE.findall(text):
+            values = every.setdefault(name, [])
+            if value not in values:
+                values.append(value)
+
+    defines = {}
+    for text in texts:
+        # Unknown conditions are None and keep both branches
+        blocks = []
+        active = True
+        for line in text.splitlines():
+            directive = DIRECTIVE_RE.match(line)
+            if directive:
+                keyword, condition = directive.group(1), directive.group(2).strip()
+                if keyword == "if":
+                    value = evaluate(condition, every)
+                elif keyword in ("ifdef", "ifndef"):
+                    value = int((condition in every) == (keyword == "ifdef"))
+                if keyword in ("if", "ifdef", "ifndef"):
+                    blocks.append((active, value))
+                    active = active and value != 0
+                elif keyword == "else" and blocks:
+                    parent, value = blocks[-1]
+                    active = parent and (value is None or value == 0)
+                elif keyword == "endif" and blocks:
+                    active = blocks.pop()[0]
+                continue
+            match = DEFINE_RE.match(line)
+            if match and active:
+                values = defines.setdefault(match.group(1), [])
+                if match.group(2) not in values:
+                    values.append(match.group(2))
+    return defines
+
+
+def evaluate(expression, defines, seen=()):
+    """Return the value of a constant C expression made of numbers and macros, or None."""
+    def substitute(match):
+        name = match.group(0)
+        values = defines.get(name, [])
+        # A macro defined differently under #if branches can not be resolved
+        if name in seen or len(values) != 1:
+            raise ValueError(name)
+        return "(%d)" % evaluate(values[0], defines, seen + (name,))
+
+    text = re.sub(r"\b(0[xX][0-9a-fA-F]+|\d+)[uUlL]*\b", r"\1", expression)
+    try:
+        text = IDENTIFIER_RE.sub(substitute, text)
+    except (ValueError, TypeError):
+        return None
+    if not re.fullmatch(r"[0-9a-fA-FxX()+\-*/%<>&|~ \t]*", text):
+        return None
+    try:
+        return int(eval(text.replace("/", "//"), {"__builtins__": {}}))
+    except (SyntaxError, ZeroDivisionError, TypeError):
+        return None
+
+
+def read_task_stack_sizes(sources):
+    """Return {task function: stackWords expression} for the tasks defined with TASK_DEFINE ()."""
+    sizes = {}
+    for path in sources:
+        with open(path, errors="replace") as src:
+            text = src.read()
+        for func, expression in TASK_DEFINE_SIZE_RE.findall(text):
+            sizes[func] = expression
+    return sizes
+
+
+class Analyzer:
+    def __init__(self, frames, graph, warnings):
+        self.frames = frames
+        self.graph = graph
+        self.warnings = warnings
+        self.memo = {}
+
+    def depth(self, func, path=()):
+        """Return (bytes, call chain) of the deepest call chain from func."""
+        if func in path:
+            raise RecursionError(" -> ".join(path + (func,)))
+        if func in self.memo:
+            return self.memo[func]
+        if func not in self.frames:
+            self.warnings.add("no stack usage for %s, assuming 0 bytes" % func)
+        deepest, chain = 0, ()
+        for callee in sorted(self.graph.get(func, ())):
+            callee_depth, callee_chain = self.depth(callee, path + (func,))
+            if callee_depth > deepest:
+                deepest, chain = callee_depth, callee_chain
+        result = (self.frames.get(func, 0) + deepest, (func,) + chain)
+        self.memo[func] = result
+        return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("binaries", nargs="+",
+                        help="the linked ELF, or the object files of the build")
+    parser.add_argument("--objdump", default="arm-none-eabi-objdump")
+    parser.add_argument("--su", nargs="*", default=None,
+                        help=".su files (default: every .su file next to each binary)")
+    parser.add_argument("--src", action="append", default=None,
+                        help="directory searched for .c sources and kernel_config.h, can be repeated (default: .)")
+    parser.add_argument("--stack-size", type=int, default=None,
+                        help="stack size in words (default: STACK_SIZE from kernel_config.h)")
+    parser.add_argument("--reserved-words", type=int, default=None,
+                        help="words at the bottom of each stack the task can not use "
+                             "(default: 15 with USE_MPU_STACK_GUARD, else the 2 canaries)")
+    parser.add_argument("--no-fpu-frame", action="store_true",
+                        help="assume tasks never use the FPU, so the exception frame is 8 words instead of 26")
+    parser.add_argument("--emit-header", metavar="FILE",
+                        help="write right-sized <TASK>_STACK_WORDS constants to FILE")
+    args = parser.parse_args()
+
+    if args.src is None:
+        args.src = ["."]
+    su_files = args.su
+    if su_files is None:
+        su_files = set()
+        for binary in args.binaries:
+            su_files.update(glob.glob(os.path.join(os.path.dirname(binary) or ".", "*.su")))
+        su_files = sorted(su_files)
+    sources = []
+    for src_dir in args.src:
+        sources += glob.glob(os.path.join(src_dir, "**", "*.c"), recursive=True)
+
+    frames, dynamic = read_stack_usage(su_files)
+    graph, indirect = read_call_graph(args.objdump, args.binaries)
+    roots, deferred = find_roots(sources)
+    for caller, callees in deferred.items():
+        graph.setdefault(caller, set()).update(callees)
+        indirect.discard(caller)
+
+    warnings = set()
+    defines = read_defines(args.src)
+    stack_size = args.stack_size or evaluate("STACK_SIZE", defines)
+    task_stack_sizes = read_task_stack_sizes(sources)
+    reserved_words = args.reserved_words
+    if reserved_words is None:
+        reserved_words = (MPU_GUARD_RESERVED_WORDS if evaluate("USE_MPU_STACK_GUARD", defines)
+                          else CANARY_RESERVED_WORDS)
+    exception_frame = (BASIC_EXCEPTION_FRAME_BYTES if args.no_fpu_frame
+                       else FPU_EXCEPTION_FRAME_BYTES)
+    overhead = exception_frame + CALLEE_SAVED_BYTES + reserved_words * 4
+
+    analyzer = Analyzer(frames, graph, warnings)
+    failed = False
+    results = []
+
+    for root in roots:
+        if root not in graph:
+            continue
+        try:
+            depth, chain = analyzer.depth(root)
+        except RecursionError as error:
+            print("error: %s: recursion, depth is unbounded: %s" % (root, error))
+            failed = True
+            continue
+        for func in chain:
+            if func in indirect:
+                warnings.add("%s calls through a function pointer, those callees are not counted" % func)
+            if func in dynamic:
+                warnings.add("%s has a dynamic stack frame" % func)
+        words = math.ceil((depth + overhead) / 4)
+        results.append((root, depth, words, chain))
+
+    print("%-28s %10s %8s %8s  %s" % ("task", "calls (B)", "words", "stack", "deepest chain"))
+    for root, depth, words, chain in results:
+        size = stack_size
+        if root in task_stack_sizes:
+            size = evaluate(task_stack_sizes[root], defines)
+            if size is None:
+                warnings.add("can not evaluate the stack size %s of %s"
+                             % (task_stack_sizes[root], root))
+        status = ""
+        if size is not None and words > size:
+            status = "  OVERFLOW"
+            failed = True
+        print("%-28s %10d %8d %8s  %s%s" % (root, depth, words, "?" if size is None else size,
+                                            " -> ".join(chain), status))
+    print("\nEach task also needs %d bytes for the exception frame, r4-r11 and reserved words."
+          % overhead)
+    for warning in sorted(warnings):
+        print("warning: %s" % warning)
+
+    if args.emit_header:
+        with open(args.emit_header, "w") as header:
+            header.write("/* Generated by Tools/stack_analyzer.py, do not edit. */\n\n")
+            header.write("#ifndef STACK_SIZES_H_\n#define STACK_SIZES_H_\n\n")
+            for root, _, words, _ in results:
+                header.write("#define %s_STACK_WORDS %dU\n" % (root.upper(), words))
+            header.write("\n#endif\n")
+
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
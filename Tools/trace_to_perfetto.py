@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+"""
+Convert a dump of the SRTOS trace ring buffer into Chrome trace / Perfetto JSON.
+
+The dump is a raw binary image of `traceBuffer` (sizeof (TraceBuffer) bytes
+starting at &traceBuffer), for example from gdb:
+
+    dump binary memory trace.bin &traceBuffer ((char *)&traceBuffer) + sizeof (traceBuffer)
+
+Usage:
+
+    python3 Tools/trace_to_perfetto.py trace.bin -o trace.json --cpu-hz 8000000
+
+Open the output in https://ui.perfetto.dev or chrome://tracing. Every task is
+shown as its own track, a slice is drawn for every period a task was switched
+in, and arrows link each tick preemption to the task switch it caused.
+
+The layout must match `TraceBuffer` and `TraceRecord` in `Inc/trace.h`.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+TRACE_BUFFER_MAGIC = 0x54524345
+HEADER_FORMAT = "<3I"
+RECORD_FORMAT = "<IBBH"
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+RECORD_SIZE = struct.calcsize(RECORD_FORMAT)
+
+EVENT_TASK_CREATE = 0
+EVENT_TASK_SWITCH_IN = 1
+EVENT_TASK_DELAY = 2
+EVENT_TASK_UNBLOCK = 3
+EVENT_TICK_PREEMPT = 4
+
+EVENT_NAMES = {
+    EVENT_TASK_CREATE: "create",
+    EVENT_TASK_SWITCH_IN: "switch in",
+    EVENT_TASK_DELAY: "delay",
+    EVENT_TASK_UNBLOCK: "unblock",
+    EVENT_TICK_PREEMPT: "tick preempt",
+}
+
+
+def parse_buffer(data):
+    """Return the records in the buffer, oldest first, with unwrapped timestamps."""
+    magic, capacity, write_index = struct.unpack_from(HEADER_FORMAT, data, 0)
+    if magic != TRACE_BUFFER_MAGIC:
+        raise ValueError("bad magic 0x%08X, is this a dump of traceBuffer?" % magic)
+    if HEADER_SIZE + capacity * RECORD_SIZE > len(data):
+        raise ValueError("dump is shorter than the %d record buffer" % capacity)
+
+    count = min(write_index, capacity)
+    first = write_index - count
+    records = []
+    last_raw = None
+    cycles = 0
+    for index in range(first, write_index):
+        offset = HEADER_SIZE + (index % capacity) * RECORD_SIZE
+        raw, event, priority, task_id = struct.unpack_from(RECORD_FORMAT, data, offset)
+        if last_raw is not None:
+            cycles += (raw - last_raw) & 0xFFFFFFFF
+        last_raw = raw
+        records.append((cycles, event, priority, task_id))
+
+    dropped = first
+    return records, dropped
+
+
+def to_chrome_trace(records, cpu_hz):
+    def us(cycles):
+        return cycles * 1e6 / cpu_hz
+
+    events = []
+    priorities = {}
+    running = None
+    running_since = 0
+    pending_flow = None
+    flow_id = 0
+
+    for cycles, event, priority, task_id in records:
+        priorities[task_id] = priority
+        name = EVENT_NAMES.get(event, "event %d" % event)
+
+        if event == EVENT_TASK_SWITCH_IN:
+            if running is not None:
+                events.append({"name": "task %d" % running, "ph": "X", "pid": 0,
+                               "tid": running, "ts": us(running_since),
+                               "dur": us(cycles - running_since)})
+            if pending_flow is not None:
+                events.append({"name": "preemption", "cat": "sched", "ph": "f",
+                               "bp": "e", "id": pending_flow, "pid": 0,
+                               "tid": task_id, "ts": us(cycles)})
+                pending_flow = None
+            running = task_id
+            running_since = cycles
+            continue
+
+        events.append({"name": name, "cat": "sched", "ph": "i", "s": "t",
+                       "pid": 0, "tid": task_id if running is None else running,
+                       "ts": us(cycles), "args": {"task": task_id,
+                                                  "priority": priority}})
+
+        if event == EVENT_TICK_PREEMPT and running is not None:
+            flow_id += 1
+            pending_flow = flow_id
+            events.append({"name": "preemption", "cat": "sched", "ph": "s",
+                           "id": flow_id, "pid": 0, "tid": running,
+                           "ts": us(cycles)})
+
+    if running is not None and records:
+        end = records[-1][0]
+        events.append({"name": "task %d" % running, "ph": "X", "pid": 0,
+                       "tid": running, "ts": us(running_since),
+                       "dur": us(end - running_since)})
+
+    for task_id, priority in sorted(priorities.items()):
+        events.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": task_id,
+                       "args": {"name": "task %d (priority %d)" % (task_id, priority)}})
+        events.append({"name": "thread_sort_index", "ph": "M", "pid": 0,
+                       "tid": task_id, "args": {"sort_index": -priority}})
+    events.append({"name": "process_name", "ph": "M", "pid": 0,
+                   "args": {"name": "SRTOS"}})
+
+    return {"traceEvents": events, "displayTimeUnit": "ns"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("dump", help="binary dump of traceBuffer")
+    parser.add_argument("-o", "--output", default="-",
+                        help="output JSON file (default: stdout)")
+    parser.add_argument("--cpu-hz", type=float, default=8e6,
+                        help="core clock used for CYCCNT (default: 8 MHz HSE)")
+    args = parser.parse_args()
+
+    with open(args.dump, "rb") as dump:
+        data = dump.read()
+
+    try:
+        records, dropped = parse_buffer(data)
+    except ValueError as error:
+        print("error: %s" % error, file=sys.stderr)
+        return 1
+
+    if dropped:
+        print("note: %d older records were overwritten" % dropped, file=sys.stderr)
+
+    trace = to_chrome_trace(records, args.cpu_hz)
+    if args.output == "-":
+        json.dump(trace, sys.stdout, indent=1)
+    else:
+        with open(args.output, "w") as out:
+            json.dump(trace, out, indent=1)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())